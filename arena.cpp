@@ -0,0 +1,33 @@
+#include <algorithm>
+#include <cstdint>
+#include "arena.h"
+
+til::arena::~arena() {
+  for (auto it = _destructors.rbegin(); it != _destructors.rend(); ++it)
+    it->second(it->first);
+  for (char *chunk : _chunks)
+    ::operator delete(chunk);
+}
+
+void *til::arena::allocate(size_t size, size_t alignment) {
+  size_t padding = -reinterpret_cast<uintptr_t>(_next) & (alignment - 1);
+  if (_next == nullptr || padding + size > static_cast<size_t>(_end - _next)) {
+    // oversized requests get a chunk of their own
+    size_t chunk_size = std::max(CHUNK_SIZE, size + alignment);
+    _next = static_cast<char*>(::operator new(chunk_size));
+    _end = _next + chunk_size;
+    _chunks.push_back(_next);
+    _reserved += chunk_size;
+    padding = -reinterpret_cast<uintptr_t>(_next) & (alignment - 1);
+  }
+
+  void *p = _next + padding;
+  _next += padding + size;
+  _used += padding + size;
+  return p;
+}
+
+til::arena &til::arena::ast() {
+  static arena self;
+  return self;
+}
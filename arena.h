@@ -0,0 +1,63 @@
+#ifndef __TIL_ARENA_H__
+#define __TIL_ARENA_H__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+namespace til {
+
+  /**
+   * Bump-pointer allocator for objects that live as long as the compilation:
+   * syntax tree nodes and token text. Objects are created with make() and
+   * never destroyed individually: when the arena is destroyed, it runs their
+   * destructors (the last one created first) and releases the memory in one
+   * shot.
+   */
+  class arena {
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    std::vector<char*> _chunks;
+    char *_next = nullptr, *_end = nullptr;
+    size_t _used = 0, _reserved = 0;
+
+    std::vector<std::pair<void*, void (*)(void*)>> _destructors;
+
+  public:
+    arena() = default;
+    arena(const arena&) = delete;
+    arena &operator=(const arena&) = delete;
+    ~arena();
+
+  public:
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template<typename T, typename... Args>
+    T *make(Args &&...args) {
+      T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      if constexpr (!std::is_trivially_destructible_v<T>)
+        _destructors.emplace_back(object, [](void *p) { static_cast<T*>(p)->~T(); });
+      return object;
+    }
+
+    /** Bytes handed out (including alignment padding). */
+    size_t used() const {
+      return _used;
+    }
+
+    /** Bytes obtained from the system. */
+    size_t reserved() const {
+      return _reserved;
+    }
+
+  public:
+    /** The arena of the current compilation. */
+    static arena &ast();
+
+  };
+
+} // til
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <cdk/ast/expression_node.h>
 #include "block_node.h"
+#include "targets/types.h"
 
 namespace til {
 
@@ -15,7 +16,7 @@ namespace til {
   public:
     program_node(int lineno, til::block_node *block) :
         cdk::expression_node(lineno), _block(block) {
-      type(cdk::functional_type::create(cdk::primitive_type::create(4, cdk::TYPE_INT)));
+      type(til::types::functional(til::types::primitive(4, cdk::TYPE_INT)));
     }
 
     til::block_node *block() { return _block; }
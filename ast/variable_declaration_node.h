@@ -2,6 +2,7 @@
 #define __TIL_AST_VARIABLE_DECLARATION_NODE_H__
 
 #include <cdk/ast/expression_node.h>
+#include "targets/symbol.h"
 
 namespace til {
 
@@ -12,6 +13,8 @@ namespace til {
     int _qualifier;
     std::string _identifier;
     cdk::expression_node *_initializer;
+    std::shared_ptr<til::symbol> _symbol; // set by the name resolver
+    std::shared_ptr<til::symbol> _forward; // forward declaration being defined, if any
 
   public:
     variable_declaration_node(int lineno, int qualifier, std::shared_ptr<cdk::basic_type> varType, const std::string &identifier,
@@ -26,6 +29,12 @@ namespace til {
 
     cdk::expression_node *initializer() { return _initializer; }
 
+    std::shared_ptr<til::symbol> symbol() { return _symbol; }
+    void symbol(std::shared_ptr<til::symbol> symbol) { _symbol = symbol; }
+
+    std::shared_ptr<til::symbol> forward() { return _forward; }
+    void forward(std::shared_ptr<til::symbol> forward) { _forward = forward; }
+
     void accept(basic_ast_visitor *sp, int level) { sp->do_variable_declaration_node(this, level); }
 
   };
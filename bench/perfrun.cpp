@@ -0,0 +1,103 @@
+// Run a program several times and report its median wall time and the
+// median number of user-space instructions retired (perf_event_open).
+//
+//   bench/perfrun <runs> <program> [args...]
+//
+// Prints "<median seconds> <median instructions>"; instructions are "n/a"
+// when hardware counters are not available (e.g., in some VMs, or with a
+// restrictive /proc/sys/kernel/perf_event_paranoid). The program's output
+// is discarded.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+
+namespace {
+
+  // counts instructions of this process and of the children it creates
+  int open_counter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  double now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+  }
+
+  template<typename T>
+  T median(std::vector<T> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+  }
+
+} // anonymous
+
+int main(int argc, char *argv[]) {
+  int runs = argc > 2 ? std::atoi(argv[1]) : 0;
+  if (runs <= 0) {
+    std::fprintf(stderr, "usage: %s <runs> <program> [args...]\n", argv[0]);
+    return 1;
+  }
+
+  int counter = open_counter();
+  std::vector<double> times;
+  std::vector<long long> instructions;
+
+  for (int run = 0; run < runs; run++) {
+    if (counter >= 0) {
+      ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+      ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    double start = now();
+
+    pid_t child = fork();
+    if (child == 0) {
+      int devnull = open("/dev/null", O_WRONLY);
+      dup2(devnull, STDOUT_FILENO);
+      execv(argv[2], argv + 2);
+      _exit(127);
+    }
+    int status;
+    waitpid(child, &status, 0);
+
+    times.push_back(now() - start);
+    if (counter >= 0) {
+      ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+      long long count;
+      if (read(counter, &count, sizeof(count)) == sizeof(count))
+        instructions.push_back(count);
+    }
+
+    // TIL programs return their own exit status: only a failed exec or a
+    // signal is an error
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+      std::fprintf(stderr, "%s: run failed\n", argv[2]);
+      return 1;
+    }
+  }
+
+  if (instructions.empty())
+    std::printf("%.6f n/a\n", median(times));
+  else
+    std::printf("%.6f %lld\n", median(times), median(instructions));
+  return 0;
+}
@@ -0,0 +1,92 @@
+#!/bin/bash
+
+# Runtime benchmark: compiles the programs in bench/programs, links them
+# with the RTS (as test.sh does) and runs each one RUNS times.
+#
+#   bench/runtime.sh               all programs
+#   bench/runtime.sh fib matmul    some programs
+#   TARGET=x86reg bench/runtime.sh with the register-allocating target
+#   TARGET=x86_64 bench/runtime.sh with the x86-64 target (and rts64/)
+#
+# Each program's output must first match its checksum in
+# bench/programs/expected.sha1. For each program, reports the median wall
+# time, the median number of instructions retired (if hardware counters
+# are available, see bench/perfrun.cpp) and the number of instructions in
+# the generated assembly. Results are written to bench/results/runtime.csv.
+
+RUNS=${RUNS:-5}
+TARGET=${TARGET:-asm}
+
+if [ "$TARGET" = "x86_64" ]; then
+  OBJ_FORMAT=elf64
+  LINKER=(cc -no-pie -nostartfiles)
+  RTS_LIB_DIR=${RTS_LIB_DIR:-rts64}
+else
+  OBJ_FORMAT=elf32
+  LINKER=(ld -melf_i386)
+  RTS_LIB_DIR=${RTS_LIB_DIR:-$HOME/compiladores/root/usr/lib}
+fi
+
+RESULTS=bench/results/runtime.csv
+
+if [ $# -gt 0 ]; then
+  PROGRAMS=("$@")
+else
+  PROGRAMS=($(ls bench/programs/*.til | xargs -n1 basename | sed 's/\.til$//'))
+fi
+
+# Compile the project and the measuring tool
+echo "Compiling the project..."
+make > /dev/null && make bench/perfrun > /dev/null && \
+  { [ "$TARGET" != "x86_64" ] || make rts64/librts.a > /dev/null; }
+if [ $? -ne 0 ]; then
+  echo "Compilation failed"
+  exit 1
+fi
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf $WORKDIR' EXIT
+
+mkdir -p bench/results
+echo "program,median_seconds,instructions,static_instructions" > $RESULTS
+
+for program in ${PROGRAMS[@]}
+do
+  cp bench/programs/$program.til $WORKDIR/
+  asm_file=$WORKDIR/$program.asm
+  obj_file=$WORKDIR/$program.o
+  exec_file=$WORKDIR/$program
+
+  ./til --target $TARGET -o $asm_file $WORKDIR/$program.til && \
+    yasm -f$OBJ_FORMAT -o $obj_file $asm_file && \
+    "${LINKER[@]}" -o $exec_file $obj_file -L$RTS_LIB_DIR -lrts
+  if [ $? -ne 0 ]; then
+    echo "$program: build failed"
+    exit 1
+  fi
+
+  # a wrong result is not worth timing (whitespace is ignored, as in test.sh)
+  expected=$(awk -v program=$program '$2 == program { print $1 }' bench/programs/expected.sha1)
+  actual=$($exec_file | tr -d '[:space:]' | sha1sum | cut -d' ' -f1)
+  if [ "$actual" != "$expected" ]; then
+    echo "$program: wrong output (see bench/programs/expected.sha1)"
+    exit 1
+  fi
+
+  # instructions in the text segment: indented lines that are not
+  # directives or comments (labels start at column 0)
+  static=$(awk '
+    $1 == "segment" || $1 == "section" { text = ($2 ~ /text/); next }
+    text && /^[ \t]+[a-z]/ && $1 !~ /^(align|global|extern)$/ { n++ }
+    END { print n + 0 }
+  ' $asm_file)
+
+  read seconds instructions < <(./bench/perfrun $RUNS $exec_file)
+  if [ -z "$seconds" ]; then
+    echo "$program: run failed"
+    exit 1
+  fi
+
+  printf "%-10s %10s s %14s instructions %8s static\n" $program $seconds $instructions $static
+  echo "$program,$seconds,$instructions,$static" >> $RESULTS
+done
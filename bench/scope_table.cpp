@@ -0,0 +1,98 @@
+// Microbenchmark: til::scope_table vs cdk::symbol_table.
+//
+// For 10, 1k and 100k global symbols (plus a few nested scopes on top),
+// measures the cost of a lookup and of a push/insert/pop cycle.
+//
+//   make bench/scope_table && ./bench/scope_table
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <cdk/symbol_table.h>
+#include "targets/scope_table.h"
+#include "targets/symbol.h"
+
+namespace {
+
+  const int NESTING = 8;          // nested scopes above the global one
+  const int LOCALS = 4;           // symbols per nested scope
+  const size_t LOOKUPS = 1000000;
+  const size_t CYCLES = 200000;
+
+  double now() {
+    using namespace std::chrono;
+    return duration<double, std::nano>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  template<typename Table>
+  void fill(Table &table, const std::vector<std::string> &names) {
+    auto symbol = til::make_symbol(nullptr, "", 0);
+    for (auto &name : names)
+      table.insert(name, symbol);
+    for (int d = 0; d < NESTING; d++) {
+      table.push();
+      for (int l = 0; l < LOCALS; l++)
+        table.insert("local" + std::to_string(l), symbol);
+    }
+  }
+
+  template<typename Table>
+  double lookup(Table &table, const std::vector<std::string> &queries) {
+    size_t found = 0;
+    double start = now();
+    for (size_t i = 0; i < LOOKUPS; i++)
+      found += table.find(queries[i % queries.size()]) != nullptr;
+    double elapsed = now() - start;
+    if (found != LOOKUPS)
+      std::fprintf(stderr, "lookup failed\n");
+    return elapsed / LOOKUPS;
+  }
+
+  template<typename Table>
+  double push_pop(Table &table, const std::vector<std::string> &locals) {
+    auto symbol = til::make_symbol(nullptr, "", 0);
+    double start = now();
+    for (size_t i = 0; i < CYCLES; i++) {
+      table.push();
+      for (auto &name : locals)
+        table.insert(name, symbol);
+      table.pop();
+    }
+    return (now() - start) / CYCLES;
+  }
+
+  template<typename Table>
+  void run(const char *label, size_t n) {
+    std::vector<std::string> names, queries, locals;
+    for (size_t i = 0; i < n; i++)
+      names.push_back("variable" + std::to_string(i));
+
+    std::mt19937 random(42);
+    for (size_t i = 0; i < 4096; i++) {
+      if (i % 4 == 0)
+        queries.push_back("local" + std::to_string(random() % LOCALS));
+      else
+        queries.push_back(names[random() % n]);
+    }
+    for (int l = 0; l < LOCALS; l++)
+      locals.push_back("block" + std::to_string(l));
+
+    Table table;
+    fill(table, names);
+    double find_ns = lookup(table, queries);
+    double cycle_ns = push_pop(table, locals);
+    std::printf("%-18s %8zu %14.1f %18.1f\n", label, n, find_ns, cycle_ns);
+  }
+
+} // anonymous
+
+int main() {
+  std::printf("%-18s %8s %14s %18s\n", "table", "symbols", "ns/lookup", "ns/push+4+pop");
+  for (size_t n : { 10, 1000, 100000 }) {
+    run<cdk::symbol_table<til::symbol>>("cdk::symbol_table", n);
+    run<til::scope_table<til::symbol>>("til::scope_table", n);
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+#!/bin/bash
+
+# Compiler throughput benchmark: generates synthetic TIL programs of
+# increasing size (see bench/workload.cpp) and measures how fast
+# "./til --target asm" compiles them.
+#
+#   bench/throughput.sh                  run and compare with the baseline
+#   bench/throughput.sh --save-baseline  run and store the results as baseline
+#
+# Results are written to bench/results/throughput.csv. Each size is
+# compiled REPEAT times and the fastest run is kept. Throughput is
+# reported in lines/sec and bytes/sec; regressions are checked on
+# bytes/sec, which is meaningful for every workload (e.g., long strings
+# add bytes but no lines). A row is a regression if its throughput is
+# more than TOLERANCE percent below the baseline. Independently of the machine, a workload
+# also regresses if the throughput at its largest size is less than
+# 1/SCALING of the throughput at its smallest size (e.g., quadratic
+# behaviour). Peak memory is taken from the compiler's own --time-report.
+
+TOLERANCE=${TOLERANCE:-25}
+SCALING=${SCALING:-4}
+REPEAT=${REPEAT:-3}
+
+RESULTS=bench/results/throughput.csv
+BASELINE=bench/baseline/throughput.csv
+
+WORKLOADS=(expr block functions globals strings mixed)
+declare -A SIZES=(
+  [expr]="100 400 1600"
+  [block]="1000 4000 16000"
+  [functions]="50 200 800"
+  [globals]="1000 4000 16000"
+  [strings]="10000 40000 160000"
+  [mixed]="100 400 1600"
+)
+
+# Compile the project and the generator
+echo "Compiling the project..."
+make > /dev/null && make bench/workload > /dev/null
+if [ $? -ne 0 ]; then
+  echo "Compilation failed"
+  exit 1
+fi
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf $WORKDIR' EXIT
+
+mkdir -p bench/results
+echo "workload,size,lines,bytes,seconds,lines_per_sec,bytes_per_sec,peak_rss_kb" > $RESULTS
+
+for workload in ${WORKLOADS[@]}
+do
+  for size in ${SIZES[$workload]}
+  do
+    source_file=$WORKDIR/$workload-$size.til
+    ./bench/workload $workload $size > $source_file
+    lines=$(wc -l < $source_file)
+    bytes=$(wc -c < $source_file)
+
+    best=0
+    rss=0
+    for run in $(seq $REPEAT)
+    do
+      start=$(date +%s%N)
+      TIL_FLAGS=--time-report ./til --target asm $source_file > /dev/null 2> $WORKDIR/report
+      if [ $? -ne 0 ]; then
+        echo "$workload $size: compilation failed"
+        exit 1
+      fi
+      elapsed=$(( $(date +%s%N) - start )) # nanoseconds
+      if [ $best -eq 0 ] || [ $elapsed -lt $best ]; then
+        best=$elapsed
+        rss=$(awk '$2 == "output" { print $5 }' $WORKDIR/report)
+      fi
+    done
+
+    seconds=$(awk -v ns=$best 'BEGIN { printf "%.6f", ns / 1e9 }')
+    rate=$(awk -v ns=$best -v lines=$lines 'BEGIN { printf "%.0f", lines / (ns / 1e9) }')
+    byterate=$(awk -v ns=$best -v bytes=$bytes 'BEGIN { printf "%.0f", bytes / (ns / 1e9) }')
+    printf "%-10s %8d %9d lines %10s s %10s lines/s %12s bytes/s %8s KB\n" $workload $size $lines $seconds $rate $byterate $rss
+    echo "$workload,$size,$lines,$bytes,$seconds,$rate,$byterate,$rss" >> $RESULTS
+  done
+done
+
+if [ "$1" = "--save-baseline" ]; then
+  mkdir -p bench/baseline
+  cp $RESULTS $BASELINE
+  echo "Baseline saved to $BASELINE"
+fi
+
+# Compare with the baseline (if any) and check the scaling of each workload
+[ -f $BASELINE ] || BASELINE=/dev/null
+awk -F, -v tolerance=$TOLERANCE -v scaling=$SCALING '
+  FILENAME == ARGV[1] { if (FNR > 1) baseline[$1 "," $2] = $7; next }
+  FNR == 1 { next }
+  {
+    key = $1 "," $2
+    if (key in baseline && $7 < baseline[key] * (1 - tolerance / 100)) {
+      printf "REGRESSION %s %s: %.0f bytes/s (baseline %.0f)\n", $1, $2, $7, baseline[key]
+      failed = 1
+    }
+    if (!($1 in smallest)) smallest[$1] = $7
+    largest[$1] = $7
+  }
+  END {
+    for (w in smallest)
+      if (largest[w] * scaling < smallest[w]) {
+        printf "SCALING %s: %.0f bytes/s at the largest size, %.0f at the smallest\n", w, largest[w], smallest[w]
+        failed = 1
+      }
+    exit failed
+  }
+' $BASELINE $RESULTS
@@ -0,0 +1,111 @@
+// Synthetic TIL workloads for compiler throughput benchmarks.
+//
+//   bench/workload <kind> <size> > program.til
+//
+// Kinds (size is the scaling parameter):
+//   expr       expression nested <size> levels deep
+//   block      one block with <size> locals and <size> assignments
+//   functions  <size> function literals, each nested in the previous one
+//   globals    <size> global variables, all used by the program
+//   strings    16 global strings of <size> characters each
+//   mixed      <size> top-level functions with loops, ifs and blocks
+//
+// Every program is valid TIL and prints a result, so it can also be run.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+  void expr(int size) {
+    std::printf("(program\n  (int x 1)\n  (println\n");
+    for (int i = 0; i < size; i++)
+      std::printf("%*s(+ x\n", 4 + i % 32, "");
+    std::printf("%*sx", 4, "");
+    for (int i = 0; i < size; i++)
+      std::printf(")");
+    std::printf(")\n  (return 0)\n)\n");
+  }
+
+  void block(int size) {
+    std::printf("(program\n");
+    for (int i = 0; i < size; i++)
+      std::printf("  (int v%d %d)\n", i, i % 100);
+    for (int i = 0; i < size; i++)
+      std::printf("  (set v%d (+ v%d (* v%d 2)))\n", i, i, (i * 7) % size);
+    std::printf("  (println v%d)\n  (return 0)\n)\n", size - 1);
+  }
+
+  void functions(int size) {
+    for (int i = 0; i < size; i++)
+      std::printf("%*s(var f%d (function (int (int a)) (int b (+ a %d))\n", i % 32, "", i, i);
+    std::printf("%*s(return b)", size % 32, "");
+    for (int i = size - 1; i >= 0; i--) {
+      std::printf("))\n");
+      if (i > 0)
+        std::printf("%*s(return (f%d b))", i % 32, "", i);
+    }
+    std::printf("(program\n  (println (f0 1))\n  (return 0)\n)\n");
+  }
+
+  void globals(int size) {
+    for (int i = 0; i < size; i++)
+      std::printf("(int g%d %d)\n", i, i % 100);
+    std::printf("(program\n  (int sum 0)\n");
+    for (int i = 0; i < size; i++)
+      std::printf("  (set sum (+ sum g%d))\n", i);
+    std::printf("  (println sum)\n  (return 0)\n)\n");
+  }
+
+  void strings(int size) {
+    for (int s = 0; s < 16; s++) {
+      std::printf("(string s%d \"", s);
+      for (int i = 0; i < size; i++)
+        std::putchar('a' + (i + s) % 26);
+      std::printf("\")\n");
+    }
+    std::printf("(program\n");
+    for (int s = 0; s < 16; s++)
+      std::printf("  (println s%d)\n", s);
+    std::printf("  (return 0)\n)\n");
+  }
+
+  void mixed(int size) {
+    for (int i = 0; i < size; i++) {
+      std::printf("(var f%d (function (int (int n))\n", i);
+      std::printf("  (int i 0)\n  (int acc %d)\n", i);
+      std::printf("  (loop (< i n)\n");
+      std::printf("    (block (int t (* i i))\n");
+      std::printf("      (if (== (%% t 2) 0) (set acc (+ acc t)) (set acc (- acc 1)))\n");
+      std::printf("      (set i (+ i 1))))\n");
+      std::printf("  (return acc)))\n");
+    }
+    std::printf("(program\n  (int total 0)\n");
+    for (int i = 0; i < size; i++)
+      std::printf("  (set total (+ total (f%d 10)))\n", i);
+    std::printf("  (println total)\n  (return 0)\n)\n");
+  }
+
+} // anonymous
+
+int main(int argc, char *argv[]) {
+  static const struct {
+    const char *kind;
+    void (*generate)(int);
+  } kinds[] = {
+    { "expr", expr }, { "block", block }, { "functions", functions },
+    { "globals", globals }, { "strings", strings }, { "mixed", mixed },
+  };
+
+  if (argc == 3 && std::atoi(argv[2]) > 0)
+    for (auto &k : kinds)
+      if (std::strcmp(argv[1], k.kind) == 0) {
+        k.generate(std::atoi(argv[2]));
+        return 0;
+      }
+
+  std::fprintf(stderr, "usage: %s {expr|block|functions|globals|strings|mixed} <size>\n", argv[0]);
+  return 1;
+}
@@ -0,0 +1,100 @@
+/*
+ * Runtime library for the x86_64 target: the functions the compiler
+ * calls (print*, read*) and the ones programs may declare as external
+ * (argc, argv, envp), with the output formats of the ix86 RTS.
+ *
+ * As in the ix86 RTS, the entry point is _start, which calls the
+ * program's "_main" function, so programs may define "main" themselves:
+ * they are linked with the C library, but without its start files.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int _argc;
+static char **_argv, **_envp;
+
+int argc(void) {
+  return _argc;
+}
+
+char *argv(int n) {
+  return n >= 0 && n < _argc ? _argv[n] : NULL;
+}
+
+char *envp(int n) {
+  for (int i = 0; i <= n; i++)
+    if (!_envp[i])
+      return NULL;
+  return _envp[n];
+}
+
+void printi(int value) {
+  printf("%d", value);
+}
+
+void prints(const char *string) {
+  fputs(string, stdout);
+}
+
+/* up to 15 significant digits, without trailing zeros; a non-zero exponent follows "E" */
+void printd(double value) {
+  char buffer[32], *exponent, *end;
+  if (value == 0) {
+    putchar('0');
+    return;
+  }
+  snprintf(buffer, sizeof(buffer), "%.14e", value);
+  exponent = strchr(buffer, 'e');
+  if (!exponent) { /* inf, nan */
+    fputs(buffer, stdout);
+    return;
+  }
+  *exponent++ = '\0';
+  for (end = exponent - 2; *end == '0'; end--)
+    *end = '\0';
+  if (*end == '.')
+    *end = '\0';
+  fputs(buffer, stdout);
+  if (atoi(exponent) != 0)
+    printf("E%d", atoi(exponent));
+}
+
+void println(void) {
+  putchar('\n');
+}
+
+int readi(void) {
+  int value = 0;
+  if (scanf("%d", &value) != 1)
+    return 0;
+  return value;
+}
+
+double readd(void) {
+  double value = 0;
+  if (scanf("%lf", &value) != 1)
+    return 0;
+  return value;
+}
+
+int _main(void);
+
+void _rts_start(int count, char **arguments, char **environment) {
+  _argc = count;
+  _argv = arguments;
+  _envp = environment;
+  exit(_main());
+}
+
+/* the stack holds argc, the arguments and the environment */
+__asm__(".text\n"
+        ".globl _start\n"
+        "_start:\n"
+        "\txor %ebp, %ebp\n"
+        "\tmov (%rsp), %rdi\n"
+        "\tlea 8(%rsp), %rsi\n"
+        "\tlea 8(%rsi,%rdi,8), %rdx\n"
+        "\tand $-16, %rsp\n"
+        "\tcall _rts_start\n"
+        "\thlt\n");
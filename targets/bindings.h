@@ -0,0 +1,53 @@
+#ifndef __TIL_TARGETS_BINDINGS_H__
+#define __TIL_TARGETS_BINDINGS_H__
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <cdk/ast/variable_node.h>
+#include "targets/symbol.h"
+
+namespace til {
+
+  /**
+   * Symbol bound to each identifier occurrence. Filled once by the name
+   * resolver: later passes read the binding instead of looking names up.
+   * (cdk::variable_node belongs to the CDK, so the binding cannot be a
+   * field of the node itself.)
+   *
+   * The resolver also records the functions (definitions or the program)
+   * whose frames may be pointed to: they allocate stack memory (objects)
+   * or take the address of a local or argument. Those frames must stay
+   * alive while a call made by their function runs.
+   */
+  class bindings {
+    std::unordered_map<const cdk::variable_node*, std::shared_ptr<til::symbol>> _symbols;
+    std::unordered_set<const cdk::basic_node*> _referencedFrames;
+
+  public:
+    void bind(const cdk::variable_node *node, std::shared_ptr<til::symbol> symbol) {
+      _symbols[node] = symbol;
+    }
+
+    std::shared_ptr<til::symbol> symbol(const cdk::variable_node *node) const {
+      auto it = _symbols.find(node);
+      return it == _symbols.end() ? nullptr : it->second;
+    }
+
+    size_t size() const {
+      return _symbols.size();
+    }
+
+    void set_frame_referenced(const cdk::basic_node *function) {
+      _referencedFrames.insert(function);
+    }
+
+    /** Pointers into the function's frame may exist: no call can take its place. */
+    bool frame_referenced(const cdk::basic_node *function) const {
+      return _referencedFrames.count(function) > 0;
+    }
+  };
+
+} // til
+
+#endif
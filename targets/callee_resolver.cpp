@@ -0,0 +1,243 @@
+#include <string>
+#include "targets/callee_resolver.h"
+#include ".auto/all_nodes.h"  // automatically generated
+
+//---------------------------------------------------------------------------
+
+void til::callee_resolver::define(const til::symbol *variable, cdk::expression_node *const value) {
+  cdk::typed_node *definition = value;
+  if (auto rvalue = dynamic_cast<cdk::rvalue_node*>(value))
+    definition = rvalue->lvalue();
+
+  if (dynamic_cast<til::function_definition_node*>(definition) || dynamic_cast<cdk::variable_node*>(definition))
+    _definitions[variable].push_back(definition);
+  else
+    _definitions[variable].push_back(nullptr);
+}
+
+void til::callee_resolver::solve() {
+  // each variable goes from no value, to one literal, to any function
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (auto &[variable, definitions] : _definitions) {
+      auto known = _callees.find(variable);
+      if (known != _callees.end() && !known->second)
+        continue;
+
+      bool defined = known != _callees.end();
+      til::function_definition_node *callee = defined ? known->second : nullptr;
+      for (auto definition : definitions) {
+        til::function_definition_node *value = nullptr;
+        if (auto source = dynamic_cast<cdk::variable_node*>(definition)) {
+          auto symbol = _bindings.symbol(source).get();
+          auto it = _callees.find(symbol);
+          if (it == _callees.end() && _definitions.count(symbol))
+            continue; // not known yet
+          value = it == _callees.end() ? nullptr : it->second;
+        }
+        else
+          value = dynamic_cast<til::function_definition_node*>(definition);
+
+        if (!defined)
+          callee = value;
+        else if (callee != value)
+          callee = nullptr;
+        defined = true;
+        if (!callee)
+          break;
+      }
+
+      if (defined && (known == _callees.end() || known->second != callee)) {
+        _callees[variable] = callee;
+        changed = true;
+      }
+    }
+  }
+
+  // a variable whose address is taken may also be assigned through a pointer
+  for (auto it = _callees.begin(); it != _callees.end();)
+    if (!it->second || it->first->addressed())
+      it = _callees.erase(it);
+    else
+      ++it;
+}
+
+//---------------------------------------------------------------------------
+
+void til::callee_resolver::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_not_node(cdk::not_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_add_node(cdk::add_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_sub_node(cdk::sub_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_mul_node(cdk::mul_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_div_node(cdk::div_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_mod_node(cdk::mod_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_lt_node(cdk::lt_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_le_node(cdk::le_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_ge_node(cdk::ge_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_gt_node(cdk::gt_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_ne_node(cdk::ne_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_eq_node(cdk::eq_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_and_node(cdk::and_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_or_node(cdk::or_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_variable_node(cdk::variable_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+  node->rvalue()->accept(this, lvl + 2);
+  if (auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue()))
+    if (variable->is_typed(cdk::TYPE_FUNCTIONAL))
+      define(_bindings.symbol(variable).get(), node->rvalue());
+}
+void til::callee_resolver::do_evaluation_node(til::evaluation_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_print_node(til::print_node *const node, int lvl) {
+  node->arguments()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_read_node(til::read_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_stop_node(til::stop_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_next_node(til::next_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_function_call_node(til::function_call_node *const node, int lvl) {
+  visit(node->expression(), lvl + 2);
+  visit(node->arguments(), lvl + 2);
+}
+void til::callee_resolver::do_return_node(til::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+}
+void til::callee_resolver::do_nullptr_node(til::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void til::callee_resolver::do_index_node(til::index_node *const node, int lvl) {
+  node->base()->accept(this, lvl + 2);
+  node->index()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_address_of_node(til::address_of_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+}
+void til::callee_resolver::do_sizeof_node(til::sizeof_node *const node, int lvl) {
+  node->expression()->accept(this, lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void til::callee_resolver::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (size_t i = 0; i < node->size(); i++)
+    node->node(i)->accept(this, lvl);
+}
+
+void til::callee_resolver::do_block_node(til::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void til::callee_resolver::do_program_node(til::program_node *const node, int lvl) {
+  node->block()->accept(this, lvl + 2);
+}
+
+void til::callee_resolver::do_loop_node(til::loop_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
+  node->block()->accept(this, lvl + 2);
+}
+
+void til::callee_resolver::do_if_node(til::if_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
+  node->block()->accept(this, lvl + 2);
+}
+
+void til::callee_resolver::do_if_else_node(til::if_else_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
+  node->thenblock()->accept(this, lvl + 2);
+  node->elseblock()->accept(this, lvl + 2);
+}
+
+void til::callee_resolver::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
+  visit(node->initializer(), lvl + 2);
+  if (!node->is_typed(cdk::TYPE_FUNCTIONAL))
+    return;
+
+  if (_inFunctionArgs)
+    _definitions[node->symbol().get()].push_back(nullptr); // any function may be passed
+  else if (node->initializer())
+    define(node->symbol().get(), node->initializer());
+}
+
+void til::callee_resolver::do_function_definition_node(til::function_definition_node *const node, int lvl) {
+  _inFunctionArgs = true;
+  visit(node->arguments(), lvl + 2);
+  _inFunctionArgs = false;
+  node->block()->accept(this, lvl + 2);
+}
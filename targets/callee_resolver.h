@@ -0,0 +1,72 @@
+#ifndef __TIL_TARGETS_CALLEE_RESOLVER_H__
+#define __TIL_TARGETS_CALLEE_RESOLVER_H__
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/bindings.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace til {
+
+  class function_definition_node;
+
+  /**
+   * Find the local variables of functional type that always hold the
+   * same function literal, so that calls through them can be direct.
+   * The analysis is flow-insensitive: the definitions of a variable (its
+   * initializer and the assignments to it) are either function literals
+   * or other functional variables, and their values are propagated until
+   * nothing changes. Arguments, variables whose address is taken and
+   * variables defined by any other expression may hold any function.
+   */
+  class callee_resolver: public basic_ast_visitor {
+    const til::bindings &_bindings;
+    bool _inFunctionArgs = false;
+
+    // definitions of each variable: a literal, a variable node or null (any function)
+    std::unordered_map<const til::symbol*, std::vector<cdk::typed_node*>> _definitions;
+
+    // solution: the literal held by each variable, or null if it may vary
+    std::unordered_map<const til::symbol*, til::function_definition_node*> _callees;
+
+  public:
+    callee_resolver(std::shared_ptr<cdk::compiler> compiler, const til::bindings &bindings) :
+        basic_ast_visitor(compiler), _bindings(bindings) {
+    }
+
+  public:
+    ~callee_resolver() {
+      os().flush();
+    }
+
+  public:
+    /** Propagate the definitions collected by the traversal (once, after it). */
+    void solve();
+
+    /** The function literal always held by the variable (null if unknown). */
+    til::function_definition_node *callee(const til::symbol *variable) const {
+      auto it = _callees.find(variable);
+      return it == _callees.end() ? nullptr : it->second;
+    }
+
+  protected:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node)
+        node->accept(this, lvl);
+    }
+
+    void define(const til::symbol *variable, cdk::expression_node *const value);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // til
+
+#endif
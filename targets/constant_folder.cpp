@@ -0,0 +1,355 @@
+#include <string>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include "targets/constant_folder.h"
+#include "targets/types.h"
+#include "targets/stats.h"
+#include "arena.h"
+#include ".auto/all_nodes.h"  // automatically generated
+
+namespace {
+
+  // integer arithmetic wraps around, as in the generated code
+  int wrap(long long value) {
+    return static_cast<int>(static_cast<uint32_t>(value));
+  }
+
+  bool same_type(cdk::typed_node *node1, cdk::typed_node *node2) {
+    return node1->type().get() == node2->type().get();
+  }
+
+  // expressions that can be dropped without losing side effects
+  bool is_pure(cdk::expression_node *node) {
+    if (dynamic_cast<cdk::integer_node*>(node) || dynamic_cast<cdk::double_node*>(node))
+      return true;
+    auto rvalue = dynamic_cast<cdk::rvalue_node*>(node);
+    return rvalue && dynamic_cast<cdk::variable_node*>(rvalue->lvalue());
+  }
+
+} // anonymous
+
+//---------------------------------------------------------------------------
+
+bool til::constant_folder::integer(cdk::expression_node *node, int &value) const {
+  node = folded(node);
+  if (auto literal = dynamic_cast<cdk::integer_node*>(node)) {
+    value = literal->value();
+    return true;
+  }
+  if (auto size = dynamic_cast<til::sizeof_node*>(node)) {
+    value = til::types::size(size->expression()->type(), _pointer);
+    return true;
+  }
+  return false;
+}
+
+bool til::constant_folder::number(cdk::expression_node *node, double &value) const {
+  int i;
+  if (integer(node, i)) {
+    value = i;
+    return true;
+  }
+  if (auto literal = dynamic_cast<cdk::double_node*>(folded(node))) {
+    value = literal->value();
+    return true;
+  }
+  return false;
+}
+
+void til::constant_folder::replace(cdk::expression_node *node, cdk::expression_node *replacement) {
+  _replacements[node] = replacement;
+  stats::add("simplified identities");
+}
+
+void til::constant_folder::fold_integer(cdk::expression_node *node, int value) {
+  auto literal = arena::ast().make<cdk::integer_node>(node->lineno(), value);
+  literal->type(til::types::primitive(4, cdk::TYPE_INT));
+  _replacements[node] = literal;
+  stats::add("folded constants");
+}
+
+void til::constant_folder::fold_double(cdk::expression_node *node, double value) {
+  if (!std::isfinite(value))
+    return; // inf and nan have no literal: computed at run time
+  auto literal = arena::ast().make<cdk::double_node>(node->lineno(), value);
+  literal->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
+  _replacements[node] = literal;
+  stats::add("folded constants");
+}
+
+void til::constant_folder::fold_comparison(cdk::binary_operation_node *const node, int lvl,
+                                           bool (*compare)(double, double)) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  double x, y; // 32-bit integers are exact as doubles
+  if (number(node->left(), x) && number(node->right(), y))
+    fold_integer(node, compare(x, y));
+}
+
+//---------------------------------------------------------------------------
+
+void til::constant_folder::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void til::constant_folder::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+  if (!node->is_typed(cdk::TYPE_INT) || !node->argument()->is_typed(cdk::TYPE_INT))
+    return;
+
+  int i;
+  if (integer(node->argument(), i)) {
+    fold_integer(node, wrap(-static_cast<long long>(i)));
+  }
+  else if (auto minus = dynamic_cast<cdk::unary_minus_node*>(folded(node->argument()))) {
+    if (same_type(node, minus->argument())) // -(-x)
+      replace(node, folded(minus->argument()));
+  }
+}
+
+void til::constant_folder::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+  if (same_type(node, node->argument()))
+    replace(node, folded(node->argument()));
+}
+
+//---------------------------------------------------------------------------
+
+void til::constant_folder::do_add_node(cdk::add_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  int i, j;
+  double x, y;
+  if (node->is_typed(cdk::TYPE_INT) && integer(node->left(), i) && integer(node->right(), j))
+    fold_integer(node, wrap(static_cast<long long>(i) + j));
+  else if (node->is_typed(cdk::TYPE_DOUBLE) && number(node->left(), x) && number(node->right(), y))
+    fold_double(node, x + y);
+  else if (node->is_typed(cdk::TYPE_DOUBLE))
+    return; // x+0 is not x for x = -0.0
+  else if (integer(node->right(), j) && j == 0 && same_type(node, node->left()))
+    replace(node, folded(node->left()));
+  else if (integer(node->left(), i) && i == 0 && same_type(node, node->right()))
+    replace(node, folded(node->right()));
+}
+
+void til::constant_folder::do_sub_node(cdk::sub_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  int i, j;
+  double x, y;
+  if (node->is_typed(cdk::TYPE_INT) && integer(node->left(), i) && integer(node->right(), j))
+    fold_integer(node, wrap(static_cast<long long>(i) - j));
+  else if (node->is_typed(cdk::TYPE_DOUBLE) && number(node->left(), x) && number(node->right(), y))
+    fold_double(node, x - y);
+  else if (!node->is_typed(cdk::TYPE_DOUBLE) && integer(node->right(), j) && j == 0 &&
+           same_type(node, node->left()))
+    replace(node, folded(node->left()));
+}
+
+void til::constant_folder::do_mul_node(cdk::mul_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  int i, j;
+  double x, y;
+  if (node->is_typed(cdk::TYPE_INT) && integer(node->left(), i) && integer(node->right(), j))
+    fold_integer(node, wrap(static_cast<long long>(i) * j));
+  else if (node->is_typed(cdk::TYPE_DOUBLE) && number(node->left(), x) && number(node->right(), y))
+    fold_double(node, x * y);
+  else if (number(node->right(), y) && y == 1 && same_type(node, node->left()))
+    replace(node, folded(node->left()));
+  else if (number(node->left(), x) && x == 1 && same_type(node, node->right()))
+    replace(node, folded(node->right()));
+  else if (node->is_typed(cdk::TYPE_INT) && integer(node->right(), j) && j == 0 && is_pure(folded(node->left())))
+    fold_integer(node, 0);
+  else if (node->is_typed(cdk::TYPE_INT) && integer(node->left(), i) && i == 0 && is_pure(folded(node->right())))
+    fold_integer(node, 0);
+}
+
+void til::constant_folder::do_div_node(cdk::div_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  // integer division by zero (or overflow) is left to fail at run time
+  int i, j;
+  double x, y;
+  if (node->is_typed(cdk::TYPE_INT) && integer(node->left(), i) && integer(node->right(), j)) {
+    if (j != 0 && !(i == INT_MIN && j == -1))
+      fold_integer(node, i / j);
+  }
+  else if (node->is_typed(cdk::TYPE_DOUBLE) && number(node->left(), x) && number(node->right(), y)) {
+    fold_double(node, x / y);
+  }
+  else if (number(node->right(), y) && y == 1 && same_type(node, node->left())) {
+    replace(node, folded(node->left()));
+  }
+}
+
+void til::constant_folder::do_mod_node(cdk::mod_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  int i, j;
+  if (integer(node->left(), i) && integer(node->right(), j) && j != 0 && !(i == INT_MIN && j == -1))
+    fold_integer(node, i % j);
+}
+
+//---------------------------------------------------------------------------
+
+void til::constant_folder::do_lt_node(cdk::lt_node *const node, int lvl) {
+  fold_comparison(node, lvl, [](double x, double y) { return x < y; });
+}
+void til::constant_folder::do_le_node(cdk::le_node *const node, int lvl) {
+  fold_comparison(node, lvl, [](double x, double y) { return x <= y; });
+}
+void til::constant_folder::do_ge_node(cdk::ge_node *const node, int lvl) {
+  fold_comparison(node, lvl, [](double x, double y) { return x >= y; });
+}
+void til::constant_folder::do_gt_node(cdk::gt_node *const node, int lvl) {
+  fold_comparison(node, lvl, [](double x, double y) { return x > y; });
+}
+void til::constant_folder::do_ne_node(cdk::ne_node *const node, int lvl) {
+  fold_comparison(node, lvl, [](double x, double y) { return x != y; });
+}
+void til::constant_folder::do_eq_node(cdk::eq_node *const node, int lvl) {
+  fold_comparison(node, lvl, [](double x, double y) { return x == y; });
+}
+
+//---------------------------------------------------------------------------
+
+void til::constant_folder::do_not_node(cdk::not_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+
+  int i;
+  if (integer(node->argument(), i))
+    fold_integer(node, !i);
+}
+
+void til::constant_folder::do_and_node(cdk::and_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  // the right argument is not evaluated if the left one is false
+  int i, j = 0;
+  if (integer(node->left(), i) && (i == 0 || integer(node->right(), j)))
+    fold_integer(node, i != 0 && j != 0);
+}
+
+void til::constant_folder::do_or_node(cdk::or_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+
+  // the right argument is not evaluated if the left one is true
+  int i, j = 0;
+  if (integer(node->left(), i) && (i != 0 || integer(node->right(), j)))
+    fold_integer(node, i != 0 || j != 0);
+}
+
+//---------------------------------------------------------------------------
+
+void til::constant_folder::do_variable_node(cdk::variable_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+}
+void til::constant_folder::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+  node->rvalue()->accept(this, lvl + 2);
+}
+void til::constant_folder::do_evaluation_node(til::evaluation_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::constant_folder::do_print_node(til::print_node *const node, int lvl) {
+  node->arguments()->accept(this, lvl + 2);
+}
+void til::constant_folder::do_read_node(til::read_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_stop_node(til::stop_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_next_node(til::next_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_function_call_node(til::function_call_node *const node, int lvl) {
+  visit(node->expression(), lvl + 2);
+  visit(node->arguments(), lvl + 2);
+}
+void til::constant_folder::do_return_node(til::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+}
+void til::constant_folder::do_nullptr_node(til::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void til::constant_folder::do_index_node(til::index_node *const node, int lvl) {
+  node->base()->accept(this, lvl + 2);
+  node->index()->accept(this, lvl + 2);
+}
+void til::constant_folder::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::constant_folder::do_address_of_node(til::address_of_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+}
+void til::constant_folder::do_sizeof_node(til::sizeof_node *const node, int lvl) {
+  // EMPTY: the expression is not evaluated
+}
+
+//---------------------------------------------------------------------------
+
+void til::constant_folder::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (size_t i = 0; i < node->size(); i++)
+    node->node(i)->accept(this, lvl);
+}
+
+void til::constant_folder::do_block_node(til::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void til::constant_folder::do_program_node(til::program_node *const node, int lvl) {
+  node->block()->accept(this, lvl + 2);
+}
+
+void til::constant_folder::do_loop_node(til::loop_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
+  node->block()->accept(this, lvl + 2);
+}
+
+void til::constant_folder::do_if_node(til::if_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
+  node->block()->accept(this, lvl + 2);
+}
+
+void til::constant_folder::do_if_else_node(til::if_else_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
+  node->thenblock()->accept(this, lvl + 2);
+  node->elseblock()->accept(this, lvl + 2);
+}
+
+void til::constant_folder::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
+  visit(node->initializer(), lvl + 2);
+}
+
+void til::constant_folder::do_function_definition_node(til::function_definition_node *const node, int lvl) {
+  node->block()->accept(this, lvl + 2);
+}
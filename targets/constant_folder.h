@@ -0,0 +1,69 @@
+#ifndef __TIL_TARGETS_CONSTANT_FOLDER_H__
+#define __TIL_TARGETS_CONSTANT_FOLDER_H__
+
+#include "targets/basic_ast_visitor.h"
+
+#include <unordered_map>
+
+namespace til {
+
+  /**
+   * Fold constant expressions and simplify algebraic identities (x+0,
+   * x*1, ...) in a single bottom-up traversal of the typed tree.
+   *
+   * The operands of CDK nodes cannot be replaced, so the rewritten tree
+   * is described by a table: an expression that was folded or simplified
+   * maps to the expression that replaces it (a new literal or one of its
+   * operands), which the code generator emits instead. Replacements always
+   * have the type of the expression they replace.
+   */
+  class constant_folder: public basic_ast_visitor {
+    std::unordered_map<const cdk::expression_node*, cdk::expression_node*> _replacements;
+    size_t _pointer; // size of pointers on the target (for sizeof)
+
+  public:
+    constant_folder(std::shared_ptr<cdk::compiler> compiler, size_t pointer = 4) :
+        basic_ast_visitor(compiler), _pointer(pointer) {
+    }
+
+  public:
+    ~constant_folder() {
+      os().flush();
+    }
+
+  public:
+    /** The expression to generate in place of the given one. */
+    cdk::expression_node *folded(cdk::expression_node *node) const {
+      auto replacement = _replacements.find(node);
+      return replacement == _replacements.end() ? node : replacement->second;
+    }
+
+    /** Whether the (folded) expression is an integer constant. */
+    bool integer(cdk::expression_node *node, int &value) const;
+
+    /** Whether the (folded) expression is an integer or double constant. */
+    bool number(cdk::expression_node *node, double &value) const;
+
+  protected:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node)
+        node->accept(this, lvl);
+    }
+
+    void replace(cdk::expression_node *node, cdk::expression_node *replacement);
+    void fold_integer(cdk::expression_node *node, int value);
+    void fold_double(cdk::expression_node *node, double value);
+    void fold_comparison(cdk::binary_operation_node *const node, int lvl, bool (*compare)(double, double));
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // til
+
+#endif
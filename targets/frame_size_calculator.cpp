@@ -1,13 +1,16 @@
 #include <string>
-#include "targets/type_checker.h"
+#include <algorithm>
 #include "targets/frame_size_calculator.h"
 #include ".auto/all_nodes.h"  // automatically generated
 
-// #include <string>
-// #include <sstream>
-// #include "targets/type_checker.h"
-// #include "targets/postfix_writer.h"
-// #include ".auto/all_nodes.h"  // automatically generated
+//---------------------------------------------------------------------------
+
+void til::frame_size_calculator::do_frame(const cdk::basic_node *function, cdk::basic_node *const body, int lvl) {
+  _localsize.push_back(frame());
+  body->accept(this, lvl + 2);
+  _frames[function] = _localsize.back().peak;
+  _localsize.pop_back();
+}
 
 //---------------------------------------------------------------------------
 
@@ -27,67 +30,81 @@ void til::frame_size_calculator::do_string_node(cdk::string_node *const node, in
   // EMPTY
 }
 void til::frame_size_calculator::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
-  // EMPTY
+  node->argument()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
-  // EMPTY
+  node->argument()->accept(this, lvl + 2);
+}
+void til::frame_size_calculator::do_not_node(cdk::not_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_add_node(cdk::add_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_sub_node(cdk::sub_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_mul_node(cdk::mul_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_div_node(cdk::div_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_mod_node(cdk::mod_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_lt_node(cdk::lt_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_le_node(cdk::le_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_ge_node(cdk::ge_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_gt_node(cdk::gt_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_ne_node(cdk::ne_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_eq_node(cdk::eq_node *const node, int lvl) {
-  // EMPTY
-}
-void til::frame_size_calculator::do_not_node(cdk::not_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_and_node(cdk::and_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_or_node(cdk::or_node *const node, int lvl) {
-  // EMPTY
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_variable_node(cdk::variable_node *const node, int lvl) {
   // EMPTY
 }
 void til::frame_size_calculator::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
-  // EMPTY
+  node->lvalue()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_assignment_node(cdk::assignment_node *const node, int lvl) {
-  // EMPTY
+  node->lvalue()->accept(this, lvl + 2);
+  node->rvalue()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_evaluation_node(til::evaluation_node *const node, int lvl) {
-  // EMPTY
+  node->argument()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_print_node(til::print_node *const node, int lvl) {
-  // EMPTY
+  node->arguments()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_read_node(til::read_node *const node, int lvl) {
   // EMPTY
@@ -99,25 +116,41 @@ void til::frame_size_calculator::do_next_node(til::next_node *const node, int lv
   // EMPTY
 }
 void til::frame_size_calculator::do_function_call_node(til::function_call_node *const node, int lvl) {
-  // EMPTY
+  visit(node->expression(), lvl + 2);
+  visit(node->arguments(), lvl + 2);
+
+  auto callee = _inliner ? _inliner->inlined(node) : nullptr;
+  if (!callee || _localsize.empty())
+    return;
+
+  if (!_frames.count(callee)) // not computed yet
+    do_frame(callee, callee->block(), lvl);
+  size_t arguments = 0;
+  if (callee->arguments())
+    for (size_t i = 0; i < callee->arguments()->size(); i++)
+      arguments += static_cast<cdk::typed_node*>(callee->arguments()->node(i))->type()->size();
+
+  frame &f = _localsize.back();
+  f.peak = std::max(f.peak, f.live + arguments + _frames.at(callee));
 }
 void til::frame_size_calculator::do_return_node(til::return_node *const node, int lvl) {
-  // EMPTY
+  visit(node->retval(), lvl + 2);
 }
 void til::frame_size_calculator::do_nullptr_node(til::nullptr_node *const node, int lvl) {
   // EMPTY
 }
 void til::frame_size_calculator::do_index_node(til::index_node *const node, int lvl) {
-  // EMPTY
+  node->base()->accept(this, lvl + 2);
+  node->index()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
-  // EMPTY
+  node->argument()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_address_of_node(til::address_of_node *const node, int lvl) {
-  // EMPTY
+  node->lvalue()->accept(this, lvl + 2);
 }
 void til::frame_size_calculator::do_sizeof_node(til::sizeof_node *const node, int lvl) {
-  // EMPTY
+  node->expression()->accept(this, lvl + 2);
 }
 
 //---------------------------------------------------------------------------
@@ -128,36 +161,48 @@ void til::frame_size_calculator::do_sequence_node(cdk::sequence_node *const node
 }
 
 void til::frame_size_calculator::do_block_node(til::block_node *const node, int lvl) {
-  _symtab.push(); // for block-local vars
-  if (node->declarations())
-    node->declarations()->accept(this, lvl + 2);
-  if (node->instructions())
-    node->instructions()->accept(this, lvl + 2);
-  _symtab.pop();
+  if (_localsize.empty()) {
+    visit(node->declarations(), lvl + 2);
+    visit(node->instructions(), lvl + 2);
+    return;
+  }
+
+  size_t live = _localsize.back().live;
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+  _localsize.back().live = live; // the block's locals are dead: reuse their slots
 }
 
 void til::frame_size_calculator::do_program_node(til::program_node *const node, int lvl) {
-    node->block()->accept(this, lvl + 2);
+  do_frame(node, node->block(), lvl);
 }
 
 void til::frame_size_calculator::do_loop_node(til::loop_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
   node->block()->accept(this, lvl + 2);
 }
 
 void til::frame_size_calculator::do_if_node(til::if_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
   node->block()->accept(this, lvl + 2);
 }
 
 void til::frame_size_calculator::do_if_else_node(til::if_else_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 2);
   node->thenblock()->accept(this, lvl + 2);
   node->elseblock()->accept(this, lvl + 2);
 }
 
 void til::frame_size_calculator::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  _localsize += node->type()->size();
+  if (!_localsize.empty()) { // globals have no frame
+    frame &f = _localsize.back();
+    f.live += node->type()->size();
+    f.peak = std::max(f.peak, f.live);
+  }
+  visit(node->initializer(), lvl + 2); // may define functions
 }
 
 void til::frame_size_calculator::do_function_definition_node(til::function_definition_node *const node, int lvl) {
-  node->block()->accept(this, lvl + 2);
+  // arguments are in the caller's frame
+  do_frame(node, node->block(), lvl);
 }
@@ -2,22 +2,39 @@
 #define __TIL_TARGETS_FRAME_SIZE_CALCULATOR_H__
 
 #include "targets/basic_ast_visitor.h"
+#include "targets/inliner.h"
 
-#include <sstream>
-#include <stack>
+#include <unordered_map>
+#include <vector>
 
 namespace til {
 
+  /**
+   * Compute, in a single traversal of the whole tree, the size of the
+   * local variables of every function (and of the main program). Locals
+   * of nested functions belong to their own frames only.
+   *
+   * Variables of disjoint blocks share stack slots: a block's locals are
+   * released when the block ends (the code generator reuses their offsets
+   * in the same way), so a frame is as large as its deepest set of live
+   * locals, not the sum of all of them.
+   *
+   * The arguments and locals of a function inlined at a call site live in
+   * the caller's frame while the inlined body runs.
+   */
   class frame_size_calculator: public basic_ast_visitor {
-    cdk::symbol_table<til::symbol> &_symtab;
-    std::stack<std::shared_ptr<til::symbol>> _functions;
+    struct frame {
+      size_t live = 0; // locals of the open blocks
+      size_t peak = 0; // frame size
+    };
 
-    size_t _localsize;
+    const til::inliner *_inliner;
+    std::vector<frame> _localsize; // one entry per enclosing function
+    std::unordered_map<const cdk::basic_node*, size_t> _frames;
 
   public:
-    frame_size_calculator(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<til::symbol> &symtab, 
-                          std::stack<std::shared_ptr<til::symbol>> functions) :
-        basic_ast_visitor(compiler), _symtab(symtab), _functions(functions), _localsize(0) {
+    frame_size_calculator(std::shared_ptr<cdk::compiler> compiler, const til::inliner *inliner = nullptr) :
+        basic_ast_visitor(compiler), _inliner(inliner) {
     }
 
   public:
@@ -26,10 +43,19 @@ namespace til {
     }
 
   public:
-    size_t localsize() const {
-      return _localsize;
+    /** Stack size for the locals of a function definition or program node. */
+    size_t localsize(const cdk::basic_node *function) const {
+      return _frames.at(function);
     }
 
+  protected:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node)
+        node->accept(this, lvl);
+    }
+
+    void do_frame(const cdk::basic_node *function, cdk::basic_node *const body, int lvl);
+
   public:
   // do not edit these lines
 #define __IN_VISITOR_HEADER__
@@ -0,0 +1,279 @@
+#include <string>
+#include "targets/inliner.h"
+#include ".auto/all_nodes.h"  // automatically generated
+#include "til_parser.tab.h"
+
+//---------------------------------------------------------------------------
+
+bool til::inliner::recursive(const function &f) const {
+  // only functions bound to variables and external ones can be called from the body
+  std::vector<const function*> pending = { &f };
+  std::unordered_set<const function*> seen;
+  while (!pending.empty()) {
+    auto caller = pending.back();
+    pending.pop_back();
+    for (auto callee : caller->callees) {
+      if (callee->qualifier() == tEXTERNAL)
+        continue;
+      auto bound = _bound.find(callee);
+      if (bound == _bound.end())
+        return true; // unknown function
+      auto next = &_functions[bound->second];
+      if (next == &f)
+        return true;
+      if (seen.insert(next).second)
+        pending.push_back(next);
+    }
+  }
+  return false;
+}
+
+void til::inliner::solve() {
+  for (auto &[call, variable] : _calls) {
+    auto bound = _bound.find(variable);
+    if (bound != _bound.end())
+      _functions[bound->second].sites++;
+  }
+
+  for (auto &f : _functions) {
+    if (f.size > _threshold)
+      f.unsuitable = "too large";
+    else if (f.unsuitable) {
+      // EMPTY
+    }
+    else if (f.variable->qualifier() == tPUBLIC || f.variable->addressed() || _escaped.count(f.variable))
+      f.unsuitable = "escapes";
+    else if (f.variable->type() != f.definition->type()) // types are unique: compared by pointer
+      f.unsuitable = "typed differently from its variable";
+    else if (recursive(f))
+      f.unsuitable = "may be recursive";
+    f.inlined = !f.unsuitable;
+    if (f.inlined && f.global)
+      _removed.insert(f.definition);
+  }
+
+  for (auto &[call, variable] : _calls) {
+    auto bound = _bound.find(variable);
+    if (bound != _bound.end() && _functions[bound->second].inlined)
+      _inlined[call] = _functions[bound->second].definition;
+  }
+}
+
+void til::inliner::report(std::ostream &os) const {
+  for (auto &f : _functions) {
+    os << ";; inline '" << f.variable->name() << "' (line " << f.definition->lineno() << ", size " << f.size << "): ";
+    if (f.inlined)
+      os << "inlined at " << f.sites << " call site" << (f.sites == 1 ? "" : "s");
+    else if (f.size > _threshold)
+      os << "not inlined, too large (threshold " << _threshold << ")";
+    else
+      os << "not inlined, " << f.unsuitable;
+    os << std::endl;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void til::inliner::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void til::inliner::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void til::inliner::do_not_node(cdk::not_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void til::inliner::do_add_node(cdk::add_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_sub_node(cdk::sub_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_mul_node(cdk::mul_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_div_node(cdk::div_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_mod_node(cdk::mod_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_lt_node(cdk::lt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_le_node(cdk::le_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_ge_node(cdk::ge_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_gt_node(cdk::gt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_ne_node(cdk::ne_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_eq_node(cdk::eq_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_and_node(cdk::and_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_or_node(cdk::or_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void til::inliner::do_variable_node(cdk::variable_node *const node, int lvl) {
+  _escaped.insert(_bindings.symbol(node).get()); // callees are not visited as expressions
+}
+void til::inliner::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+void til::inliner::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+  visit(node->rvalue(), lvl + 2);
+}
+void til::inliner::do_evaluation_node(til::evaluation_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void til::inliner::do_print_node(til::print_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+}
+void til::inliner::do_read_node(til::read_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_stop_node(til::stop_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_next_node(til::next_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_function_call_node(til::function_call_node *const node, int lvl) {
+  const til::symbol *callee = nullptr;
+  if (auto rvalue = dynamic_cast<cdk::rvalue_node*>(node->expression()))
+    if (auto variable = dynamic_cast<cdk::variable_node*>(rvalue->lvalue()))
+      callee = _bindings.symbol(variable).get();
+
+  if (callee) {
+    _calls.emplace_back(node, callee);
+    if (!_current.empty() && _current.back())
+      _current.back()->callees.push_back(callee);
+  }
+  else if (node->expression()) {
+    visit(node->expression(), lvl + 2);
+    unsuitable("calls unknown functions");
+  }
+  else {
+    unsuitable("recursive");
+  }
+  visit(node->arguments(), lvl + 2);
+}
+void til::inliner::do_return_node(til::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+}
+void til::inliner::do_nullptr_node(til::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void til::inliner::do_index_node(til::index_node *const node, int lvl) {
+  visit(node->base(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+void til::inliner::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+  unsuitable("allocates stack memory");
+}
+void til::inliner::do_address_of_node(til::address_of_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+void til::inliner::do_sizeof_node(til::sizeof_node *const node, int lvl) {
+  visit(node->expression(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void til::inliner::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (size_t i = 0; i < node->size(); i++)
+    visit(node->node(i), lvl);
+}
+
+void til::inliner::do_block_node(til::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void til::inliner::do_program_node(til::program_node *const node, int lvl) {
+  _current.push_back(nullptr);
+  visit(node->block(), lvl + 2);
+  _current.pop_back();
+}
+
+void til::inliner::do_loop_node(til::loop_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void til::inliner::do_if_node(til::if_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void til::inliner::do_if_else_node(til::if_else_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  visit(node->thenblock(), lvl + 2);
+  visit(node->elseblock(), lvl + 2);
+}
+
+void til::inliner::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
+  auto definition = dynamic_cast<til::function_definition_node*>(node->initializer());
+  if (!definition || !node->is_typed(cdk::TYPE_FUNCTIONAL)) {
+    visit(node->initializer(), lvl + 2);
+    return;
+  }
+
+  _bound[node->symbol().get()] = _functions.size();
+  auto &f = _functions.emplace_back();
+  f.definition = definition;
+  f.variable = node->symbol().get();
+  f.global = _current.empty();
+  unsuitable("defines functions");
+
+  _current.push_back(&f);
+  visit(definition->arguments(), lvl + 2);
+  visit(definition->block(), lvl + 2);
+  _current.pop_back();
+}
+
+void til::inliner::do_function_definition_node(til::function_definition_node *const node, int lvl) {
+  unsuitable("defines functions");
+  _current.push_back(nullptr); // not bound to a variable
+  visit(node->arguments(), lvl + 2);
+  visit(node->block(), lvl + 2);
+  _current.pop_back();
+}
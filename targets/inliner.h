@@ -0,0 +1,110 @@
+#ifndef __TIL_TARGETS_INLINER_H__
+#define __TIL_TARGETS_INLINER_H__
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/bindings.h"
+
+#include <deque>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace til {
+
+  class function_definition_node;
+  class function_call_node;
+
+  /**
+   * Choose the calls whose callee's body is generated in place of the call.
+   * A function is inlined at all its call sites if it is the initializer
+   * of a (non-public) variable that is only ever called, if its body is no
+   * larger than the threshold (in syntax tree nodes), and if it cannot call
+   * itself: it only calls other such functions or external ones, and never
+   * with @. Bodies that allocate stack memory or define functions are not
+   * inlined, nor are functions whose type differs from their variable's
+   * (the calls convert arguments and results). The code generator renames the arguments and locals of an
+   * inlined body into the caller's frame.
+   */
+  class inliner: public basic_ast_visitor {
+    const til::bindings &_bindings;
+    size_t _threshold;
+
+    // a function literal bound to a variable
+    struct function {
+      til::function_definition_node *definition = nullptr;
+      const til::symbol *variable = nullptr;
+      size_t size = 0;
+      std::vector<const til::symbol*> callees; // variables called by the body
+      bool global = false;
+      const char *unsuitable = nullptr;          // why it cannot be inlined
+      size_t sites = 0;
+      bool inlined = false;
+    };
+
+    std::deque<function> _functions; // in order of definition
+    std::unordered_map<const til::symbol*, size_t> _bound; // variable -> index in _functions
+    std::unordered_set<const til::symbol*> _escaped; // used other than as callee
+    std::vector<std::pair<til::function_call_node*, const til::symbol*>> _calls; // through variables
+    std::vector<function*> _current; // function literals being visited (null if not bound)
+
+    std::unordered_map<const til::function_call_node*, til::function_definition_node*> _inlined;
+    std::unordered_set<const til::function_definition_node*> _removed;
+
+  public:
+    inliner(std::shared_ptr<cdk::compiler> compiler, const til::bindings &bindings, size_t threshold) :
+        basic_ast_visitor(compiler), _bindings(bindings), _threshold(threshold) {
+    }
+
+  public:
+    ~inliner() {
+      os().flush();
+    }
+
+  public:
+    /** Decide which functions are inlined (once, after the traversal). */
+    void solve();
+
+    /** One line per function bound to a variable: inlined or why not. */
+    void report(std::ostream &os) const;
+
+    /** The function whose body replaces the call (null if it is an actual call). */
+    til::function_definition_node *inlined(const til::function_call_node *call) const {
+      auto it = _inlined.find(call);
+      return it == _inlined.end() ? nullptr : it->second;
+    }
+
+    /** Whether the function's own code is never used (a global inlined everywhere). */
+    bool removed(const til::function_definition_node *definition) const {
+      return _removed.count(definition) > 0;
+    }
+
+  protected:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (!node)
+        return;
+      if (!_current.empty() && _current.back())
+        _current.back()->size++;
+      node->accept(this, lvl);
+    }
+
+    void unsuitable(const char *reason) {
+      if (!_current.empty() && _current.back() && !_current.back()->unsuitable)
+        _current.back()->unsuitable = reason;
+    }
+
+    bool recursive(const function &f) const;
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // til
+
+#endif
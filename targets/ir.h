@@ -0,0 +1,134 @@
+#ifndef __TIL_TARGETS_IR_H__
+#define __TIL_TARGETS_IR_H__
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace til {
+  namespace ir {
+
+    /**
+     * Virtual registers hold 32-bit integers, pointers (also strings and
+     * function addresses: as wide as the machine's addresses) or doubles.
+     * Only integer and pointer registers are given machine registers:
+     * doubles always live in their own frame slot.
+     */
+    enum regclass { INTEGER, POINTER, DOUBLE };
+
+    /** Memory operand: [symbol + frame slot + base + index * scale + disp]. */
+    struct memory {
+      std::string symbol; // global label (empty if none)
+      int slot = -1;      // frame slot (-1 if none)
+      int base = -1, index = -1; // pointer virtual registers (-1 if none)
+      int scale = 1, disp = 0;
+    };
+
+    enum condition { EQ, NE, LT, LE, GT, GE };
+
+    enum opcode {
+      MOVI,    // d = imm
+      MOV,     // d = a
+      LA,      // d = address of label
+      LEA,     // d = address of mem
+      LOAD,    // d = [mem]
+      STORE,   // [mem] = a
+      NEG,     // d = -a
+      NOT,     // d = !a
+      ADD, SUB, MUL, DIV, MOD, // d = a op b (b may be immediate)
+      SET,     // d = a cond b (b may be immediate)
+      LABEL,   // label:
+      JMP,     // goto label
+      JZ, JNZ, // if (a == 0) / if (a != 0) goto label
+      JCOND,   // if (a cond b) goto label (b may be immediate)
+      I2P,     // d = (pointer)a, sign-extended
+      P2I,     // d = (int)a, truncated
+      ALLOCA,  // d = address of a bytes on the stack
+      PARAM,   // d = argument imm (at the start of the function, all of them)
+      ARG,     // argument a (by class; may be immediate): right before CALL, the last one first
+      CALL,    // d = label(...) or a(...), then pop imm bytes of stack arguments
+      TAILCALL, // return label(...): its imm bytes of arguments take the place of the function's (same classes)
+      RET,     // return a (if any; may be immediate)
+      DMOVI,   // d = number
+      DMOV,    // d = a
+      DLOAD,   // d = [mem]
+      DSTORE,  // [mem] = a
+      I2D,     // d = (double)a
+      D2I,     // d = (int)a
+      DNEG,    // d = -a
+      DADD, DSUB, DMUL, DDIV, // d = a op b
+      DSET,    // d = a cond b (integer result)
+    };
+
+    struct instruction {
+      opcode op;
+      int d = -1, a = -1, b = -1; // virtual registers (-1 if unused)
+      bool immediate = false;     // b (or a, for ARG and RET) is imm
+      int imm = 0;
+      condition cond = EQ;
+      bool fpu = false;           // CALL: the result is a double (in st0 or xmm0)
+      double number = 0;
+      std::string label;
+      ir::memory mem;
+
+      instruction(opcode op) :
+          op(op) {
+      }
+    };
+
+    /** Frame slot: a variable that must stay in memory, or a spilled register. */
+    struct slot {
+      int size;
+
+      slot(int size) :
+          size(size) {
+      }
+    };
+
+    struct function {
+      std::string label;
+      bool global = false; // exported
+      std::vector<instruction> code;
+      std::vector<regclass> arguments; // class of each argument (see PARAM)
+      std::vector<regclass> registers; // class of each virtual register
+      std::vector<ir::slot> slots;
+
+      // after register allocation (see targets/linear_scan.h)
+      std::vector<int> machine; // machine register of each virtual register (-1: none)
+      std::vector<int> home;    // frame slot of each virtual register without one (-1: none)
+
+      int new_register(regclass c) {
+        registers.push_back(c);
+        return registers.size() - 1;
+      }
+
+      int new_slot(int size) {
+        slots.emplace_back(size);
+        return slots.size() - 1;
+      }
+    };
+
+    /** Initialized or reserved data. */
+    struct datum {
+      enum kind { INTEGER, DOUBLE, STRING, ADDRESS, SPACE } what;
+      std::string label;   // defined before the value (empty if none)
+      bool global = false; // exported
+      int integer = 0;     // INTEGER value, SPACE size
+      double number = 0;   // DOUBLE value
+      std::string text;    // STRING bytes, ADDRESS label (empty: null pointer)
+
+      datum(kind what, const std::string &label) :
+          what(what), label(label) {
+      }
+    };
+
+    struct module {
+      std::vector<ir::function> functions;
+      std::vector<datum> rodata, data, bss;
+      std::set<std::string> externs;
+    };
+
+  } // ir
+} // til
+
+#endif
@@ -0,0 +1,1002 @@
+#include <string>
+#include "targets/ir_builder.h"
+#include ".auto/all_nodes.h"  // automatically generated
+
+#include "til_parser.tab.h"
+
+//---------------------------------------------------------------------------
+
+namespace {
+
+  // the condition tested by a comparison node (false if not a comparison)
+  bool comparison_condition(cdk::expression_node *const node, til::ir::condition &cond) {
+    if (dynamic_cast<cdk::eq_node*>(node)) cond = til::ir::EQ;
+    else if (dynamic_cast<cdk::ne_node*>(node)) cond = til::ir::NE;
+    else if (dynamic_cast<cdk::lt_node*>(node)) cond = til::ir::LT;
+    else if (dynamic_cast<cdk::le_node*>(node)) cond = til::ir::LE;
+    else if (dynamic_cast<cdk::gt_node*>(node)) cond = til::ir::GT;
+    else if (dynamic_cast<cdk::ge_node*>(node)) cond = til::ir::GE;
+    else return false;
+    return true;
+  }
+
+  til::ir::condition negate(til::ir::condition cond) {
+    switch (cond) {
+      case til::ir::EQ: return til::ir::NE;
+      case til::ir::NE: return til::ir::EQ;
+      case til::ir::LT: return til::ir::GE;
+      case til::ir::LE: return til::ir::GT;
+      case til::ir::GT: return til::ir::LE;
+      default: return til::ir::LT;
+    }
+  }
+
+}
+
+//---------------------------------------------------------------------------
+
+int til::ir_builder::value(cdk::expression_node *const node, int lvl) {
+  _result = -1;
+  _label.clear();
+  _folder.folded(node)->accept(this, lvl);
+  return _result;
+}
+
+int til::ir_builder::value(cdk::expression_node *const node, ir::regclass c, int lvl) {
+  return convert(value(node, lvl), c);
+}
+
+int til::ir_builder::convert(int reg, ir::regclass c) {
+  if (reg < 0)
+    throw std::string("expression has no value");
+  ir::regclass from = regclass(reg);
+  if (from == c)
+    return reg;
+  if (from != ir::DOUBLE && c != ir::DOUBLE && _pointer == 4)
+    return reg; // ints and pointers share registers on ix86
+  int d = new_register(c);
+  ir::opcode op;
+  if (c == ir::DOUBLE)
+    op = ir::I2D;
+  else if (from == ir::DOUBLE)
+    op = ir::D2I;
+  else
+    op = c == ir::POINTER ? ir::I2P : ir::P2I;
+  auto &instr = emit(op);
+  instr.d = d;
+  instr.a = reg;
+  return d;
+}
+
+int til::ir_builder::integer(int value, ir::regclass c) {
+  int d = new_register(c);
+  auto &instr = emit(ir::MOVI);
+  instr.d = d;
+  instr.imm = value;
+  return d;
+}
+
+int til::ir_builder::operation(ir::opcode op, int a, int b) {
+  bool real = op == ir::DNEG || op == ir::DADD || op == ir::DSUB || op == ir::DMUL || op == ir::DDIV;
+  bool truth = op == ir::NOT || op == ir::SET || op == ir::DSET;
+  int d = new_register(real ? ir::DOUBLE : truth ? ir::INTEGER : regclass(a));
+  auto &instr = emit(op);
+  instr.d = d;
+  instr.a = a;
+  instr.b = b;
+  return d;
+}
+
+int til::ir_builder::operation(ir::opcode op, int a, cdk::expression_node *const right, int lvl) {
+  int value;
+  if (op != ir::DIV && op != ir::MOD && _folder.integer(right, value)) {
+    int d = new_register(regclass(a));
+    auto &instr = emit(op);
+    instr.d = d;
+    instr.a = a;
+    instr.immediate = true;
+    instr.imm = value;
+    return d;
+  }
+  return operation(op, a, this->value(right, regclass(a), lvl));
+}
+
+int til::ir_builder::comparison(cdk::binary_operation_node *const node, ir::condition cond, int lvl) {
+  int a = value(node->left(), lvl + 2);
+  int constant;
+  if (regclass(a) != ir::DOUBLE && _folder.integer(node->right(), constant)) {
+    int d = new_register(ir::INTEGER);
+    auto &instr = emit(ir::SET);
+    instr.d = d;
+    instr.a = a;
+    instr.immediate = true;
+    instr.imm = constant;
+    instr.cond = cond;
+    return d;
+  }
+
+  int b = value(node->right(), lvl + 2);
+  bool real = regclass(a) == ir::DOUBLE || regclass(b) == ir::DOUBLE;
+  if (real) {
+    a = convert(a, ir::DOUBLE);
+    b = convert(b, ir::DOUBLE);
+  }
+  else if (regclass(a) != regclass(b)) {
+    a = convert(a, ir::POINTER);
+    b = convert(b, ir::POINTER);
+  }
+  int d = operation(real ? ir::DSET : ir::SET, a, b);
+  function().code.back().cond = cond;
+  return d;
+}
+
+int til::ir_builder::scaled(cdk::expression_node *const offset, int size, int lvl) {
+  int value;
+  if (_folder.integer(offset, value))
+    return integer(static_cast<int>(static_cast<unsigned>(value) * size));
+  int reg = this->value(offset, ir::INTEGER, lvl);
+  if (size == 1)
+    return reg;
+  int d = new_register(ir::INTEGER);
+  auto &instr = emit(ir::MUL);
+  instr.d = d;
+  instr.a = reg;
+  instr.immediate = true;
+  instr.imm = size;
+  return d;
+}
+
+//---------------------------------------------------------------------------
+
+til::ir_builder::location til::ir_builder::lvalue(cdk::lvalue_node *const node, int lvl) {
+  node->accept(this, lvl);
+  return _lvalue;
+}
+
+int til::ir_builder::load(const location &where, ir::regclass c) {
+  if (where.reg >= 0)
+    return convert(where.reg, c);
+  int d = new_register(c);
+  auto &instr = emit(c == ir::DOUBLE ? ir::DLOAD : ir::LOAD);
+  instr.d = d;
+  instr.mem = where.mem;
+  return d;
+}
+
+void til::ir_builder::store(const location &where, int reg) {
+  if (where.reg >= 0) {
+    ir::regclass c = regclass(where.reg);
+    reg = convert(reg, c);
+    auto &instr = emit(c == ir::DOUBLE ? ir::DMOV : ir::MOV);
+    instr.d = where.reg;
+    instr.a = reg;
+  }
+  else {
+    auto &instr = emit(regclass(reg) == ir::DOUBLE ? ir::DSTORE : ir::STORE);
+    instr.a = reg;
+    instr.mem = where.mem;
+  }
+}
+
+til::ir_builder::location til::ir_builder::local(std::shared_ptr<til::symbol> symbol, int size, ir::regclass c) {
+  location where;
+  if (symbol->addressed())
+    where.mem.slot = function().new_slot(size);
+  else
+    where.reg = new_register(c);
+  _contexts.back()->locals[symbol.get()] = where;
+  return where;
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::label(const std::string &label) {
+  emit(ir::LABEL).label = label;
+}
+
+void til::ir_builder::jump(const std::string &label) {
+  emit(ir::JMP).label = label;
+}
+
+void til::ir_builder::branch(cdk::expression_node *const node, bool when, const std::string &target, int lvl) {
+  auto expression = _folder.folded(node);
+
+  int constant;
+  if (_folder.integer(expression, constant)) {
+    if ((constant != 0) == when)
+      jump(target);
+    return;
+  }
+
+  if (auto negation = dynamic_cast<cdk::not_node*>(expression)) {
+    branch(negation->argument(), !when, target, lvl);
+    return;
+  }
+
+  auto conjunction = dynamic_cast<cdk::and_node*>(expression);
+  auto disjunction = dynamic_cast<cdk::or_node*>(expression);
+  if (conjunction || disjunction) {
+    auto binary = static_cast<cdk::binary_operation_node*>(expression);
+    bool decides = disjunction != nullptr; // value of the left operand that decides the result
+    if (when == decides) {
+      branch(binary->left(), when, target, lvl + 2);
+      branch(binary->right(), when, target, lvl + 2);
+    }
+    else {
+      std::string skip = mklbl(++_lbl);
+      branch(binary->left(), decides, skip, lvl + 2);
+      branch(binary->right(), when, target, lvl + 2);
+      label(skip);
+    }
+    return;
+  }
+
+  ir::condition cond;
+  if (comparison_condition(expression, cond)) {
+    auto binary = static_cast<cdk::binary_operation_node*>(expression);
+    int a = value(binary->left(), lvl + 2);
+    if (regclass(a) != ir::DOUBLE) {
+      if (!when)
+        cond = negate(cond);
+      if (_folder.integer(binary->right(), constant)) {
+        auto &instr = emit(ir::JCOND);
+        instr.a = a;
+        instr.immediate = true;
+        instr.imm = constant;
+        instr.cond = cond;
+        instr.label = target;
+        return;
+      }
+      int b = value(binary->right(), lvl + 2);
+      if (regclass(b) != ir::DOUBLE) {
+        if (regclass(a) != regclass(b)) {
+          a = convert(a, ir::POINTER);
+          b = convert(b, ir::POINTER);
+        }
+        auto &instr = emit(ir::JCOND);
+        instr.a = a;
+        instr.b = b;
+        instr.cond = cond;
+        instr.label = target;
+        return;
+      }
+      if (!when)
+        cond = negate(cond); // back to the comparison itself
+      int d = operation(ir::DSET, convert(a, ir::DOUBLE), b);
+      function().code.back().cond = cond;
+      auto &instr = emit(when ? ir::JNZ : ir::JZ);
+      instr.a = d;
+      instr.label = target;
+      return;
+    }
+    int b = value(binary->right(), ir::DOUBLE, lvl + 2);
+    int d = operation(ir::DSET, a, b);
+    function().code.back().cond = cond;
+    auto &instr = emit(when ? ir::JNZ : ir::JZ);
+    instr.a = d;
+    instr.label = target;
+    return;
+  }
+
+  int reg = value(expression, lvl);
+  if (regclass(reg) == ir::DOUBLE)
+    reg = convert(reg, ir::INTEGER);
+  auto &instr = emit(when ? ir::JNZ : ir::JZ);
+  instr.a = reg;
+  instr.label = target;
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::begin_function(const cdk::basic_node *node, const std::string &label, bool global,
+                                     std::shared_ptr<cdk::basic_type> type) {
+  _contexts.push_back(std::make_unique<context>());
+  _contexts.back()->function.label = label;
+  _contexts.back()->function.global = global;
+  _contexts.back()->type = type;
+  _contexts.back()->referencedFrame = _bindings.frame_referenced(node);
+}
+
+void til::ir_builder::end_function() {
+  emit(ir::RET); // falling off the end
+
+  // drop unreachable instructions (up to the next label) and jumps to the next instruction
+  auto &code = function().code;
+  std::vector<ir::instruction> reachable;
+  for (auto &instr : code) {
+    bool dead = !reachable.empty() &&
+        (reachable.back().op == ir::JMP || reachable.back().op == ir::RET || reachable.back().op == ir::TAILCALL);
+    if (instr.op == ir::LABEL) {
+      if (dead && reachable.back().op == ir::JMP && reachable.back().label == instr.label)
+        reachable.pop_back();
+    }
+    else if (dead)
+      continue;
+    reachable.push_back(std::move(instr));
+  }
+  code = std::move(reachable);
+
+  _module.functions.push_back(std::move(function()));
+  _contexts.pop_back();
+}
+
+// ARG instructions (all of them after all the values are computed); the size of the arguments
+int til::ir_builder::pass_arguments(std::shared_ptr<cdk::basic_type> type, cdk::sequence_node *const arguments, int lvl) {
+  auto function_type = cdk::functional_type::cast(type);
+
+  // arguments are evaluated (and pushed) from right to left
+  std::vector<ir::instruction> pushes;
+  int argsSize = 0;
+  if (arguments) {
+    for (int i = arguments->size() - 1; i >= 0; i--) {
+      auto argument = dynamic_cast<cdk::expression_node*>(arguments->node(i));
+      auto input = function_type->input(i);
+      ir::instruction push(ir::ARG);
+      if (regclass(input) == ir::INTEGER && _folder.integer(argument, push.imm))
+        push.immediate = true;
+      else
+        push.a = value(argument, regclass(input), lvl + 2);
+      pushes.push_back(push);
+      argsSize += size(input);
+    }
+  }
+  for (const auto &push : pushes)
+    function().code.push_back(push);
+  return argsSize;
+}
+
+int til::ir_builder::call(const std::string &label, int address, std::shared_ptr<cdk::basic_type> type, bool external,
+                          cdk::sequence_node *const arguments, std::shared_ptr<cdk::basic_type> result, int lvl) {
+  int argsSize = pass_arguments(type, arguments, lvl);
+
+  bool fpu = result->name() == cdk::TYPE_DOUBLE || (!external && _checker.returns_double(type));
+  int d = -1;
+  if (result->name() != cdk::TYPE_VOID)
+    d = new_register(fpu ? ir::DOUBLE : regclass(result));
+
+  auto &instr = emit(ir::CALL);
+  instr.label = label;
+  instr.a = address;
+  instr.imm = argsSize;
+  instr.fpu = fpu;
+  instr.d = d;
+
+  return d < 0 ? d : convert(d, regclass(result));
+}
+
+// (return (f ...)) when f is a known function that takes the same arguments, and returns its value in the same way
+// (and this function's frame cannot be pointed to)
+bool til::ir_builder::tail_call(til::function_call_node *const node, int lvl) {
+  if (_contexts.back()->referencedFrame)
+    return false;
+
+  auto caller = cdk::functional_type::cast(_contexts.back()->type);
+  auto type = caller;
+  std::string label = function().label; // @
+  if (node->expression()) {
+    auto rvalue = dynamic_cast<cdk::rvalue_node*>(_folder.folded(node->expression()));
+    auto variable = rvalue ? dynamic_cast<cdk::variable_node*>(rvalue->lvalue()) : nullptr;
+    if (!variable || _bindings.symbol(variable)->qualifier() == tEXTERNAL)
+      return false;
+    label = lvalue(variable, lvl + 2).function;
+    type = cdk::functional_type::cast(node->expression()->type());
+  }
+  if (label.empty())
+    return false;
+
+  if (type->input_length() != caller->input_length() || type->output(0)->name() != caller->output(0)->name() ||
+      _checker.returns_double(type) != _checker.returns_double(caller))
+    return false;
+  for (size_t i = 0; i < type->input_length(); i++)
+    if (regclass(type->input(i)) != regclass(caller->input(i)))
+      return false;
+
+  int argsSize = pass_arguments(type, node->arguments(), lvl);
+  auto &instr = emit(ir::TAILCALL);
+  instr.label = label;
+  instr.imm = argsSize;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void til::ir_builder::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+
+void til::ir_builder::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (size_t i = 0; i < node->size(); i++) {
+    try {
+      node->node(i)->accept(this, lvl);
+    }
+    catch (const std::string &problem) {
+      std::cerr << node->node(i)->lineno() << ": " << problem << std::endl;
+      _errors++;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_integer_node(cdk::integer_node *const node, int lvl) {
+  _result = integer(node->value());
+}
+
+void til::ir_builder::do_double_node(cdk::double_node *const node, int lvl) {
+  _result = new_register(ir::DOUBLE);
+  auto &instr = emit(ir::DMOVI);
+  instr.d = _result;
+  instr.number = node->value();
+}
+
+void til::ir_builder::do_string_node(cdk::string_node *const node, int lvl) {
+  _result = new_register(ir::POINTER);
+  auto &instr = emit(ir::LA);
+  instr.d = _result;
+  instr.label = literal(node->value());
+}
+
+void til::ir_builder::do_nullptr_node(til::nullptr_node *const node, int lvl) {
+  _result = integer(0, ir::POINTER);
+}
+
+void til::ir_builder::do_sizeof_node(til::sizeof_node *const node, int lvl) {
+  _result = integer(size(node->expression()->type()));
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  int a = value(node->argument(), lvl + 2);
+  _result = operation(regclass(a) == ir::DOUBLE ? ir::DNEG : ir::NEG, a, -1);
+}
+
+void til::ir_builder::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  _result = value(node->argument(), lvl + 2);
+}
+
+void til::ir_builder::do_not_node(cdk::not_node *const node, int lvl) {
+  int a = value(node->argument(), lvl + 2);
+  _result = operation(ir::NOT, regclass(a) == ir::DOUBLE ? convert(a, ir::INTEGER) : a, -1);
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_add_node(cdk::add_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_POINTER)) {
+    int size = this->size(cdk::reference_type::cast(node->type())->referenced());
+    if (node->left()->is_typed(cdk::TYPE_POINTER)) {
+      int pointer = value(node->left(), ir::POINTER, lvl + 2), offset;
+      if (_folder.integer(node->right(), offset)) {
+        auto &instr = emit(ir::ADD);
+        instr.d = _result = new_register(ir::POINTER);
+        instr.a = pointer;
+        instr.immediate = true;
+        instr.imm = static_cast<int>(static_cast<unsigned>(offset) * size);
+      }
+      else
+        _result = operation(ir::ADD, pointer, convert(scaled(node->right(), size, lvl + 2), ir::POINTER));
+    }
+    else {
+      int offset = convert(scaled(node->left(), size, lvl + 2), ir::POINTER);
+      _result = operation(ir::ADD, offset, value(node->right(), ir::POINTER, lvl + 2));
+    }
+  }
+  else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    int a = value(node->left(), ir::DOUBLE, lvl + 2);
+    _result = operation(ir::DADD, a, value(node->right(), ir::DOUBLE, lvl + 2));
+  }
+  else
+    _result = operation(ir::ADD, value(node->left(), ir::INTEGER, lvl + 2), node->right(), lvl + 2);
+}
+
+void til::ir_builder::do_sub_node(cdk::sub_node *const node, int lvl) {
+  if (node->left()->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_POINTER)) {
+    int size = this->size(cdk::reference_type::cast(node->left()->type())->referenced());
+    int a = value(node->left(), ir::POINTER, lvl + 2);
+    _result = convert(operation(ir::SUB, a, value(node->right(), ir::POINTER, lvl + 2)), ir::INTEGER);
+    if (size != 1)
+      _result = operation(ir::DIV, _result, integer(size));
+  }
+  else if (node->is_typed(cdk::TYPE_POINTER)) {
+    int size = this->size(cdk::reference_type::cast(node->type())->referenced());
+    int pointer = value(node->left(), ir::POINTER, lvl + 2), offset;
+    if (_folder.integer(node->right(), offset)) {
+      auto &instr = emit(ir::SUB);
+      instr.d = _result = new_register(ir::POINTER);
+      instr.a = pointer;
+      instr.immediate = true;
+      instr.imm = static_cast<int>(static_cast<unsigned>(offset) * size);
+    }
+    else
+      _result = operation(ir::SUB, pointer, convert(scaled(node->right(), size, lvl + 2), ir::POINTER));
+  }
+  else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    int a = value(node->left(), ir::DOUBLE, lvl + 2);
+    _result = operation(ir::DSUB, a, value(node->right(), ir::DOUBLE, lvl + 2));
+  }
+  else
+    _result = operation(ir::SUB, value(node->left(), ir::INTEGER, lvl + 2), node->right(), lvl + 2);
+}
+
+void til::ir_builder::do_mul_node(cdk::mul_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    int a = value(node->left(), ir::DOUBLE, lvl + 2);
+    _result = operation(ir::DMUL, a, value(node->right(), ir::DOUBLE, lvl + 2));
+  }
+  else
+    _result = operation(ir::MUL, value(node->left(), ir::INTEGER, lvl + 2), node->right(), lvl + 2);
+}
+
+void til::ir_builder::do_div_node(cdk::div_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    int a = value(node->left(), ir::DOUBLE, lvl + 2);
+    _result = operation(ir::DDIV, a, value(node->right(), ir::DOUBLE, lvl + 2));
+  }
+  else
+    _result = operation(ir::DIV, value(node->left(), ir::INTEGER, lvl + 2), node->right(), lvl + 2);
+}
+
+void til::ir_builder::do_mod_node(cdk::mod_node *const node, int lvl) {
+  _result = operation(ir::MOD, value(node->left(), ir::INTEGER, lvl + 2), node->right(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_lt_node(cdk::lt_node *const node, int lvl) {
+  _result = comparison(node, ir::LT, lvl);
+}
+void til::ir_builder::do_le_node(cdk::le_node *const node, int lvl) {
+  _result = comparison(node, ir::LE, lvl);
+}
+void til::ir_builder::do_ge_node(cdk::ge_node *const node, int lvl) {
+  _result = comparison(node, ir::GE, lvl);
+}
+void til::ir_builder::do_gt_node(cdk::gt_node *const node, int lvl) {
+  _result = comparison(node, ir::GT, lvl);
+}
+void til::ir_builder::do_ne_node(cdk::ne_node *const node, int lvl) {
+  _result = comparison(node, ir::NE, lvl);
+}
+void til::ir_builder::do_eq_node(cdk::eq_node *const node, int lvl) {
+  _result = comparison(node, ir::EQ, lvl);
+}
+
+void til::ir_builder::do_and_node(cdk::and_node *const node, int lvl) {
+  std::string end = mklbl(++_lbl);
+  int d = integer(0);
+  branch(node, false, end, lvl);
+  auto &instr = emit(ir::MOVI);
+  instr.d = d;
+  instr.imm = 1;
+  label(end);
+  _result = d;
+}
+
+void til::ir_builder::do_or_node(cdk::or_node *const node, int lvl) {
+  std::string end = mklbl(++_lbl);
+  int d = integer(1);
+  branch(node, true, end, lvl);
+  auto &instr = emit(ir::MOVI);
+  instr.d = d;
+  instr.imm = 0;
+  label(end);
+  _result = d;
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_variable_node(cdk::variable_node *const node, int lvl) {
+  auto symbol = _bindings.symbol(node);
+
+  if (!_contexts.empty()) {
+    auto &locals = _contexts.back()->locals;
+    auto local = locals.find(symbol.get());
+    if (local != locals.end()) {
+      _lvalue = local->second;
+      return;
+    }
+  }
+
+  auto global = _globals.find(symbol.get());
+  if (global != _globals.end()) {
+    _lvalue = global->second;
+    return;
+  }
+
+  throw "'" + node->name() + "' belongs to an enclosing function";
+}
+
+void til::ir_builder::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  location where = lvalue(node->lvalue(), lvl);
+  if (!where.function.empty()) {
+    auto &instr = emit(ir::LA);
+    instr.d = _result = new_register(ir::POINTER);
+    instr.label = _label = where.function;
+  }
+  else
+    _result = load(where, regclass(node->type()));
+}
+
+void til::ir_builder::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  int first = function().registers.size();
+  int reg = value(node->rvalue(), regclass(node->type()), lvl + 2);
+  std::string function = _label;
+
+  location where = lvalue(node->lvalue(), lvl);
+  auto &code = this->function().code;
+  if (!where.function.empty()) {
+    // global functions are renamed, as in the postfix target
+    auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue());
+    if (function.empty() || !variable)
+      throw std::string("global function can only be assigned a known function");
+    _globals[_bindings.symbol(variable).get()].function = function;
+  }
+  else if (where.reg >= 0 && reg >= first && code.back().d == reg && regclass(reg) == regclass(where.reg)) {
+    code.back().d = reg = where.reg; // computed directly into the variable
+  }
+  else
+    store(where, reg);
+
+  _result = reg;
+}
+
+void til::ir_builder::do_index_node(til::index_node *const node, int lvl) {
+  int base = value(node->base(), ir::POINTER, lvl + 2);
+  int size = this->size(node->type());
+
+  location where;
+  where.mem.base = base;
+  int index;
+  if (_folder.integer(node->index(), index))
+    where.mem.disp = static_cast<int>(static_cast<unsigned>(index) * size);
+  else if (size == 1 || size == 2 || size == 4 || size == 8) {
+    where.mem.index = convert(value(node->index(), ir::INTEGER, lvl + 2), ir::POINTER);
+    where.mem.scale = size;
+  }
+  else
+    where.mem.index = convert(scaled(node->index(), size, lvl + 2), ir::POINTER);
+  _lvalue = where;
+}
+
+void til::ir_builder::do_address_of_node(til::address_of_node *const node, int lvl) {
+  location where = lvalue(node->lvalue(), lvl + 2);
+  if (where.reg >= 0)
+    throw std::string("cannot take the address of a register variable");
+  if (!where.function.empty()) {
+    auto &instr = emit(ir::LA);
+    instr.d = _result = new_register(ir::POINTER);
+    instr.label = where.function;
+    return;
+  }
+  auto &instr = emit(ir::LEA);
+  instr.d = _result = new_register(ir::POINTER);
+  instr.mem = where.mem;
+}
+
+void til::ir_builder::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
+  int size = this->size(cdk::reference_type::cast(node->type())->referenced());
+  int bytes = convert(scaled(node->argument(), size, lvl + 2), ir::POINTER);
+  auto &instr = emit(ir::ALLOCA);
+  instr.d = _result = new_register(ir::POINTER);
+  instr.a = bytes;
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_block_node(til::block_node *const node, int lvl) {
+  if (node->declarations())
+    node->declarations()->accept(this, lvl + 2);
+  if (node->instructions())
+    node->instructions()->accept(this, lvl + 2);
+}
+
+void til::ir_builder::do_program_node(til::program_node *const node, int lvl) {
+  // the RTS mandates that the main function be called "_main"
+  begin_function(node, "_main", true, node->type());
+  node->block()->accept(this, lvl);
+  end_function();
+}
+
+void til::ir_builder::do_evaluation_node(til::evaluation_node *const node, int lvl) {
+  value(node->argument(), lvl);
+}
+
+void til::ir_builder::do_print_node(til::print_node *const node, int lvl) {
+  for (size_t ix = 0; ix < node->arguments()->size(); ix++) {
+    auto argument = dynamic_cast<cdk::expression_node*>(node->arguments()->node(ix));
+
+    int reg = value(argument, lvl);
+    std::string function;
+    if (argument->is_typed(cdk::TYPE_STRING))
+      function = "prints";
+    else if (regclass(reg) == ir::DOUBLE)
+      function = "printd";
+    else if (argument->is_typed(cdk::TYPE_INT))
+      function = "printi";
+    else
+      throw std::string("cannot print expression of unknown type");
+
+    _module.externs.insert(function);
+    emit(ir::ARG).a = reg;
+    auto &instr = emit(ir::CALL);
+    instr.label = function;
+    instr.imm = regclass(reg) == ir::DOUBLE ? 8 : size(argument->type());
+  }
+
+  if (node->newline()) {
+    _module.externs.insert("println");
+    emit(ir::CALL).label = "println";
+  }
+}
+
+void til::ir_builder::do_read_node(til::read_node *const node, int lvl) {
+  bool real = node->is_typed(cdk::TYPE_DOUBLE);
+  _module.externs.insert(real ? "readd" : "readi");
+  auto &instr = emit(ir::CALL);
+  instr.label = real ? "readd" : "readi";
+  instr.fpu = real;
+  instr.d = _result = new_register(real ? ir::DOUBLE : ir::INTEGER);
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_loop_node(til::loop_node *const node, int lvl) {
+  auto &loop = *_contexts.back();
+  loop.loopTest.push_back(mklbl(++_lbl));
+  loop.loopEnd.push_back(mklbl(++_lbl));
+
+  std::string body = mklbl(++_lbl);
+
+  // rotated loop: the only test of the condition is after the body, where the entry jumps to
+  jump(loop.loopTest.back());
+  label(body);
+  node->block()->accept(this, lvl + 2);
+  label(loop.loopTest.back());
+  branch(node->condition(), true, body, lvl);
+  label(loop.loopEnd.back());
+
+  loop.loopTest.pop_back();
+  loop.loopEnd.pop_back();
+}
+
+void til::ir_builder::do_stop_node(til::stop_node *const node, int lvl) {
+  auto &loopEnd = _contexts.back()->loopEnd;
+  size_t level = static_cast<size_t>(node->level());
+  if (level <= 0)
+    throw std::string("wrong level for 'stop'");
+  if (level > loopEnd.size())
+    throw std::string("'stop' outside 'loop'");
+  jump(loopEnd[loopEnd.size() - level]);
+}
+
+void til::ir_builder::do_next_node(til::next_node *const node, int lvl) {
+  auto &loopTest = _contexts.back()->loopTest;
+  size_t level = static_cast<size_t>(node->level());
+  if (level <= 0)
+    throw std::string("wrong level for 'next'");
+  if (level > loopTest.size())
+    throw std::string("'next' outside 'loop'");
+  jump(loopTest[loopTest.size() - level]);
+}
+
+void til::ir_builder::do_if_node(til::if_node *const node, int lvl) {
+  std::string end = mklbl(++_lbl);
+  branch(node->condition(), false, end, lvl);
+  node->block()->accept(this, lvl + 2);
+  label(end);
+}
+
+void til::ir_builder::do_if_else_node(til::if_else_node *const node, int lvl) {
+  std::string otherwise = mklbl(++_lbl), end = mklbl(++_lbl);
+  branch(node->condition(), false, otherwise, lvl);
+  node->thenblock()->accept(this, lvl + 2);
+  jump(end);
+  label(otherwise);
+  node->elseblock()->accept(this, lvl + 2);
+  label(end);
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_function_definition_node(til::function_definition_node *const node, int lvl) {
+  std::string label = _nextLabel.empty() ? mklbl(++_lbl) : _nextLabel;
+  bool global = _nextGlobal;
+  _nextLabel.clear();
+  _nextGlobal = false;
+
+  // nested functions are lowered on their own: they do not see the enclosing locals
+  begin_function(node, label, global, node->type());
+  _inFunctionArgs = true;
+  if (node->arguments())
+    node->arguments()->accept(this, lvl + 4);
+  _inFunctionArgs = false;
+  for (const auto &[mem, reg] : _contexts.back()->addressed) {
+    location where;
+    where.mem = mem;
+    store(where, reg);
+  }
+  node->block()->accept(this, lvl + 2);
+  end_function();
+
+  if (!_contexts.empty()) {
+    auto &instr = emit(ir::LA);
+    instr.d = _result = new_register(ir::POINTER);
+    instr.label = label;
+  }
+  _label = label;
+}
+
+void til::ir_builder::do_function_call_node(til::function_call_node *const node, int lvl) {
+  std::shared_ptr<cdk::basic_type> type;
+  std::string label;
+  int address = -1;
+  bool external = false;
+
+  if (node->expression()) {
+    type = node->expression()->type();
+    auto callee = _folder.folded(node->expression());
+    auto rvalue = dynamic_cast<cdk::rvalue_node*>(callee);
+    auto variable = rvalue ? dynamic_cast<cdk::variable_node*>(rvalue->lvalue()) : nullptr;
+    if (variable) {
+      external = _bindings.symbol(variable)->qualifier() == tEXTERNAL;
+      location where = lvalue(variable, lvl + 2);
+      if (!where.function.empty())
+        label = where.function; // known function: direct call
+      else
+        address = load(where, ir::POINTER);
+    }
+    else
+      address = value(callee, ir::POINTER, lvl + 2);
+  }
+  else {
+    // @ recursive function call
+    type = _contexts.back()->type;
+    label = function().label;
+  }
+
+  _result = call(label, address, type, external, node->arguments(), node->type(), lvl);
+}
+
+void til::ir_builder::do_return_node(til::return_node *const node, int lvl) {
+  auto function_type = cdk::functional_type::cast(_contexts.back()->type);
+  auto output = function_type->output(0);
+
+  // a call in tail position takes the place of this function
+  if (auto call = dynamic_cast<til::function_call_node*>(node->retval()))
+    if (tail_call(call, lvl))
+      return;
+
+  int reg = -1, constant = 0;
+  bool immediate = false;
+  if (output->name() == cdk::TYPE_DOUBLE || (output->name() == cdk::TYPE_INT && _checker.returns_double(function_type)))
+    reg = value(node->retval(), ir::DOUBLE, lvl);
+  else if (output->name() == cdk::TYPE_INT && _folder.integer(node->retval(), constant))
+    immediate = true;
+  else if (output->name() != cdk::TYPE_VOID)
+    reg = value(node->retval(), regclass(output), lvl);
+
+  auto &instr = emit(ir::RET);
+  instr.a = reg;
+  instr.immediate = immediate;
+  instr.imm = constant;
+}
+
+//---------------------------------------------------------------------------
+
+void til::ir_builder::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
+  if (_contexts.empty()) {
+    declare_global(node, lvl);
+    return;
+  }
+
+  auto symbol = node->symbol();
+  int size = this->size(node->type());
+  ir::regclass c = regclass(node->type());
+
+  if (_inFunctionArgs) {
+    auto &ctx = *_contexts.back();
+    int reg = new_register(c);
+    auto &instr = emit(ir::PARAM);
+    instr.d = reg;
+    instr.imm = ctx.function.arguments.size();
+    ctx.function.arguments.push_back(c);
+
+    location where;
+    if (symbol->addressed()) {
+      where.mem.slot = ctx.function.new_slot(size);
+      ctx.addressed.emplace_back(where.mem, reg);
+    }
+    else
+      where.reg = reg;
+    ctx.locals[symbol.get()] = where;
+    return;
+  }
+
+  int first = function().registers.size(), reg = -1;
+  if (node->initializer())
+    reg = value(node->initializer(), c, lvl);
+
+  if (reg >= first && !symbol->addressed()) {
+    // a new temporary: it becomes the variable
+    location where;
+    where.reg = reg;
+    _contexts.back()->locals[symbol.get()] = where;
+    return;
+  }
+
+  location where = local(symbol, size, c); // the initializer does not see the new variable
+  if (reg >= 0)
+    store(where, reg);
+}
+
+void til::ir_builder::declare_global(til::variable_declaration_node *const node, int lvl) {
+  const std::string &id = node->identifier();
+  auto symbol = node->symbol();
+  bool functional = node->is_typed(cdk::TYPE_FUNCTIONAL);
+
+  location where;
+  if (functional)
+    where.function = id;
+  else
+    where.mem.symbol = id;
+  _globals[symbol.get()] = where;
+
+  if (node->qualifier() == tEXTERNAL || node->qualifier() == tFORWARD) {
+    _module.externs.insert(id);
+    return;
+  }
+  _module.externs.erase(id); // just in case
+
+  bool exported = node->qualifier() == tPUBLIC;
+  auto initializer = node->initializer() ? _folder.folded(node->initializer()) : nullptr;
+
+  if (functional) {
+    if (auto definition = dynamic_cast<til::function_definition_node*>(initializer)) {
+      _nextLabel = id;
+      _nextGlobal = exported;
+      definition->accept(this, lvl);
+    }
+    else if (initializer) {
+      // another global function: same label
+      auto rvalue = dynamic_cast<cdk::rvalue_node*>(initializer);
+      auto variable = rvalue ? dynamic_cast<cdk::variable_node*>(rvalue->lvalue()) : nullptr;
+      auto known = variable ? _globals.find(_bindings.symbol(variable).get()) : _globals.end();
+      if (known == _globals.end() || known->second.function.empty())
+        throw "'" + id + "' has non-constant initializer";
+      _globals[symbol.get()].function = known->second.function;
+    }
+    return;
+  }
+
+  if (!initializer) {
+    _module.bss.emplace_back(ir::datum::SPACE, id);
+    _module.bss.back().global = exported;
+    _module.bss.back().integer = size(node->type());
+    return;
+  }
+
+  int integer;
+  double number;
+  if (node->is_typed(cdk::TYPE_DOUBLE) && _folder.number(initializer, number)) {
+    _module.data.emplace_back(ir::datum::DOUBLE, id);
+    _module.data.back().number = number;
+  }
+  else if (_folder.integer(initializer, integer)) {
+    _module.data.emplace_back(ir::datum::INTEGER, id);
+    _module.data.back().integer = integer;
+  }
+  else if (dynamic_cast<til::nullptr_node*>(initializer)) {
+    _module.data.emplace_back(ir::datum::ADDRESS, id);
+  }
+  else if (auto string = dynamic_cast<cdk::string_node*>(initializer)) {
+    _module.data.emplace_back(ir::datum::ADDRESS, id);
+    _module.data.back().text = literal(string->value());
+  }
+  else
+    throw "'" + id + "' has non-constant initializer";
+  _module.data.back().global = exported;
+}
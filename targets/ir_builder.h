@@ -0,0 +1,176 @@
+#ifndef __TIL_TARGETS_IR_BUILDER_H__
+#define __TIL_TARGETS_IR_BUILDER_H__
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/bindings.h"
+#include "targets/type_checker.h"
+#include "targets/constant_folder.h"
+#include "targets/types.h"
+#include "targets/ir.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <charconv>
+
+namespace til {
+
+  /**
+   * Lower the typed syntax tree to the register IR (see targets/ir.h).
+   * Local variables and arguments become virtual registers, unless their
+   * address is taken; nested functions become functions of their own.
+   * Arguments are read with PARAM and passed with ARG, so the calling
+   * convention is left to the code generator; pointers are as wide as
+   * the target's (ints are always 4 bytes).
+   */
+  class ir_builder: public basic_ast_visitor {
+    const til::bindings &_bindings;
+    const til::type_checker &_checker;
+    const til::constant_folder &_folder;
+    ir::module &_module;
+    const int _pointer; // size of pointers: 4 (ix86) or 8 (x86-64)
+
+    // where a variable (or the result of an lvalue expression) is
+    struct location {
+      int reg = -1;         // a virtual register (promoted variable)
+      ir::memory mem;       // otherwise, memory
+      std::string function; // or a function's label (global functions)
+    };
+
+    // function being lowered
+    struct context {
+      ir::function function;
+      std::shared_ptr<cdk::basic_type> type;
+      std::unordered_map<const til::symbol*, location> locals;
+      std::vector<std::string> loopTest, loopEnd; // for next/stop
+      std::vector<std::pair<ir::memory, int>> addressed; // arguments stored in memory once all are read
+      bool referencedFrame = false; // pointers into the frame may exist (no tail calls)
+    };
+
+    std::vector<std::unique_ptr<context>> _contexts;
+    std::unordered_map<const til::symbol*, location> _globals;
+    std::unordered_map<std::string, std::string> _strings; // read-only label of each distinct literal
+    std::string _nextLabel;         // label for the function being declared (globals)
+    bool _nextGlobal = false;
+
+    bool _inFunctionArgs = false;
+    int _result = -1;  // virtual register with the value of the last expression
+    std::string _label; // label of the last expression, if it is a known function
+    location _lvalue;  // location of the last lvalue
+    size_t _errors = 0;
+    int _lbl = 0;
+
+  public:
+    ir_builder(std::shared_ptr<cdk::compiler> compiler, const til::bindings &bindings, const til::type_checker &checker,
+               const til::constant_folder &folder, ir::module &module, int pointer = 4) :
+        basic_ast_visitor(compiler), _bindings(bindings), _checker(checker), _folder(folder), _module(module),
+        _pointer(pointer) {
+    }
+
+  public:
+    ~ir_builder() {
+      os().flush();
+    }
+
+  public:
+    /** Number of errors reported: code must not be generated if non-zero. */
+    size_t errors() const {
+      return _errors;
+    }
+
+  private:
+    /** Method used to generate sequential labels. */
+    inline std::string mklbl(int lbl) {
+      char buffer[16] = { '_', 'L' };
+      char *end = std::to_chars(buffer + 2, buffer + sizeof(buffer), lbl).ptr;
+      return std::string(buffer, end);
+    }
+
+    /** Label of the string literal, stored once per module. */
+    const std::string &literal(const std::string &text) {
+      auto [it, added] = _strings.try_emplace(text);
+      if (added) {
+        it->second = mklbl(++_lbl);
+        _module.rodata.emplace_back(ir::datum::STRING, it->second);
+        _module.rodata.back().text = text;
+      }
+      return it->second;
+    }
+
+    ir::function &function() {
+      return _contexts.back()->function;
+    }
+
+    ir::instruction &emit(ir::opcode op) {
+      function().code.emplace_back(op);
+      return function().code.back();
+    }
+
+    int new_register(ir::regclass c) {
+      return function().new_register(c);
+    }
+
+    ir::regclass regclass(int reg) {
+      return function().registers[reg];
+    }
+
+    static ir::regclass regclass(std::shared_ptr<cdk::basic_type> type) {
+      switch (type->name()) {
+        case cdk::TYPE_DOUBLE:
+          return ir::DOUBLE;
+        case cdk::TYPE_POINTER:
+        case cdk::TYPE_STRING:
+        case cdk::TYPE_FUNCTIONAL:
+          return ir::POINTER;
+        default:
+          return ir::INTEGER;
+      }
+    }
+
+    int size(std::shared_ptr<cdk::basic_type> type) const {
+      return types::size(type, _pointer);
+    }
+
+    // expressions (after folding) and conversions
+    int value(cdk::expression_node *const node, int lvl);
+    int value(cdk::expression_node *const node, ir::regclass c, int lvl);
+    int convert(int reg, ir::regclass c);
+    int integer(int value, ir::regclass c = ir::INTEGER);
+    int operation(ir::opcode op, int a, int b);
+    int operation(ir::opcode op, int a, cdk::expression_node *const right, int lvl);
+    int comparison(cdk::binary_operation_node *const node, ir::condition cond, int lvl);
+    int scaled(cdk::expression_node *const offset, int size, int lvl);
+
+    // variables
+    location lvalue(cdk::lvalue_node *const node, int lvl);
+    int load(const location &where, ir::regclass c);
+    void store(const location &where, int reg);
+    location local(std::shared_ptr<til::symbol> symbol, int size, ir::regclass c);
+
+    // control flow
+    void branch(cdk::expression_node *const node, bool when, const std::string &label, int lvl);
+    void label(const std::string &label);
+    void jump(const std::string &label);
+
+    // functions
+    void begin_function(const cdk::basic_node *node, const std::string &label, bool global,
+                        std::shared_ptr<cdk::basic_type> type);
+    void end_function();
+    int pass_arguments(std::shared_ptr<cdk::basic_type> type, cdk::sequence_node *const arguments, int lvl);
+    int call(const std::string &label, int address, std::shared_ptr<cdk::basic_type> type, bool external,
+             cdk::sequence_node *const arguments, std::shared_ptr<cdk::basic_type> result, int lvl);
+    bool tail_call(til::function_call_node *const node, int lvl);
+    void declare_global(til::variable_declaration_node *const node, int lvl);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // til
+
+#endif
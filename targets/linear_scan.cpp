@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include "targets/linear_scan.h"
+
+//---------------------------------------------------------------------------
+
+namespace {
+
+  // virtual registers read by an instruction
+  template<typename F>
+  void for_uses(const til::ir::instruction &instr, F f) {
+    if (instr.a >= 0) f(instr.a);
+    if (instr.b >= 0 && !instr.immediate) f(instr.b);
+    if (instr.mem.base >= 0) f(instr.mem.base);
+    if (instr.mem.index >= 0) f(instr.mem.index);
+  }
+
+  bool is_jump(til::ir::opcode op) {
+    return op == til::ir::JMP || op == til::ir::JZ || op == til::ir::JNZ || op == til::ir::JCOND;
+  }
+
+  // nothing in the function runs after it
+  bool is_exit(til::ir::opcode op) {
+    return op == til::ir::RET || op == til::ir::TAILCALL;
+  }
+
+  // set of virtual registers
+  class bitset {
+    std::vector<uint64_t> _words;
+
+  public:
+    bitset(size_t size = 0) :
+        _words((size + 63) / 64) {
+    }
+
+    bool has(int reg) const {
+      return _words[reg / 64] >> (reg % 64) & 1;
+    }
+    void insert(int reg) {
+      _words[reg / 64] |= uint64_t(1) << (reg % 64);
+    }
+    void erase(int reg) {
+      _words[reg / 64] &= ~(uint64_t(1) << (reg % 64));
+    }
+
+    // this |= other; whether anything changed
+    bool merge(const bitset &other) {
+      bool changed = false;
+      for (size_t i = 0; i < _words.size(); i++) {
+        uint64_t word = _words[i] | other._words[i];
+        changed |= word != _words[i];
+        _words[i] = word;
+      }
+      return changed;
+    }
+
+    template<typename F>
+    void for_each(F f) const {
+      for (size_t i = 0; i < _words.size(); i++)
+        for (uint64_t word = _words[i]; word; word &= word - 1)
+          f(int(i * 64 + __builtin_ctzll(word)));
+    }
+  };
+
+  struct block {
+    size_t first, last; // instructions
+    std::vector<size_t> successors;
+    bitset in, out;
+  };
+
+  struct interval {
+    int reg;
+    size_t start, end;
+    bool crosses_call = false;
+    double weight = 0; // uses and definitions, weighted by loop depth
+  };
+
+}
+
+//---------------------------------------------------------------------------
+
+void til::linear_scan::allocate(ir::function &function) {
+  const auto &code = function.code;
+  size_t registers = function.registers.size();
+  function.machine.assign(registers, -1);
+  function.home.assign(registers, -1);
+  if (code.empty())
+    return;
+
+  // basic blocks
+  std::vector<block> blocks;
+  std::unordered_map<std::string, size_t> labels;
+  for (size_t i = 0; i < code.size(); i++) {
+    bool leader = i == 0 || code[i].op == ir::LABEL || is_jump(code[i - 1].op) || is_exit(code[i - 1].op);
+    if (leader)
+      blocks.push_back({ i, i, {}, bitset(registers), bitset(registers) });
+    blocks.back().last = i;
+    if (code[i].op == ir::LABEL)
+      labels[code[i].label] = blocks.size() - 1;
+  }
+  for (size_t b = 0; b < blocks.size(); b++) {
+    const auto &last = code[blocks[b].last];
+    if (is_jump(last.op))
+      blocks[b].successors.push_back(labels.at(last.label));
+    if (last.op != ir::JMP && !is_exit(last.op) && b + 1 < blocks.size())
+      blocks[b].successors.push_back(b + 1);
+  }
+
+  // liveness (backwards, until nothing changes)
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t b = blocks.size(); b-- > 0;) {
+      bitset live(registers);
+      for (size_t s : blocks[b].successors)
+        live.merge(blocks[s].in);
+      blocks[b].out = live;
+      for (size_t i = blocks[b].last + 1; i-- > blocks[b].first;) {
+        if (code[i].d >= 0)
+          live.erase(code[i].d);
+        for_uses(code[i], [&](int reg) { live.insert(reg); });
+      }
+      changed |= blocks[b].in.merge(live);
+    }
+  }
+
+  // live intervals of integer and pointer registers (without holes)
+  std::vector<interval> intervals(registers);
+  std::vector<bool> seen(registers, false);
+  auto extend = [&](int reg, size_t position) {
+    if (function.registers[reg] == ir::DOUBLE)
+      return;
+    if (!seen[reg]) {
+      intervals[reg] = { reg, position, position };
+      seen[reg] = true;
+    }
+    intervals[reg].start = std::min(intervals[reg].start, position);
+    intervals[reg].end = std::max(intervals[reg].end, position);
+  };
+  for (const auto &b : blocks) {
+    b.out.for_each([&](int reg) { extend(reg, b.last); });
+    b.in.for_each([&](int reg) { extend(reg, b.first); });
+    for (size_t i = b.first; i <= b.last; i++) {
+      if (code[i].op == ir::PARAM)
+        extend(code[i].d, 0); // arguments arrive together, at the entry
+      if (code[i].d >= 0)
+        extend(code[i].d, i);
+      for_uses(code[i], [&](int reg) { extend(reg, i); });
+    }
+  }
+
+  // loop depth of each instruction: backward jumps close loops
+  std::vector<int> depth(code.size(), 0);
+  std::unordered_map<std::string, size_t> positions;
+  for (size_t i = 0; i < code.size(); i++) {
+    if (code[i].op == ir::LABEL)
+      positions[code[i].label] = i;
+    else if (is_jump(code[i].op)) {
+      auto target = positions.find(code[i].label);
+      if (target != positions.end())
+        for (size_t j = target->second; j <= i; j++)
+          depth[j]++;
+    }
+  }
+
+  std::vector<size_t> calls;
+  for (size_t i = 0; i < code.size(); i++) {
+    if (code[i].op == ir::CALL)
+      calls.push_back(i);
+    double weight = 1;
+    for (int d = 0; d < std::min(depth[i], 4); d++)
+      weight *= 10;
+    if (code[i].d >= 0 && seen[code[i].d])
+      intervals[code[i].d].weight += weight;
+    for_uses(code[i], [&](int reg) {
+      if (seen[reg])
+        intervals[reg].weight += weight;
+    });
+  }
+
+  std::vector<interval> unhandled;
+  for (int reg = 0; reg < int(registers); reg++) {
+    if (!seen[reg])
+      continue;
+    auto &it = intervals[reg];
+    auto call = std::upper_bound(calls.begin(), calls.end(), it.start);
+    it.crosses_call = call != calls.end() && *call < it.end;
+    unhandled.push_back(it);
+  }
+  std::sort(unhandled.begin(), unhandled.end(), [](const interval &x, const interval &y) {
+    return x.start < y.start || (x.start == y.start && x.reg < y.reg);
+  });
+
+  // the scan: an interval ending where another starts keeps its register,
+  // so the result of an instruction never shares a register with its operands
+  std::vector<interval> active;
+  std::vector<bool> free(_registers.names.size(), true);
+  auto fits = [&](const interval &it, int machine) {
+    return !it.crosses_call || _registers.preserved[machine];
+  };
+  auto spill = [&](int reg) {
+    function.machine[reg] = -1;
+    function.home[reg] = function.new_slot(function.registers[reg] == ir::POINTER ? _registers.pointer : 4);
+    _spilled++;
+  };
+
+  for (const auto &current : unhandled) {
+    active.erase(std::remove_if(active.begin(), active.end(), [&](const interval &it) {
+      if (it.end >= current.start)
+        return false;
+      free[function.machine[it.reg]] = true;
+      return true;
+    }), active.end());
+
+    int chosen = -1;
+    for (size_t m = 0; m < free.size() && chosen < 0; m++)
+      if (free[m] && fits(current, m))
+        chosen = m;
+
+    if (chosen >= 0) {
+      free[chosen] = false;
+      function.machine[current.reg] = chosen;
+      active.push_back(current);
+      _allocated++;
+      continue;
+    }
+
+    // no register: spill the interval that is used the least (the one that ends last, on ties)
+    auto victim = active.end();
+    for (auto it = active.begin(); it != active.end(); ++it) {
+      if (!fits(current, function.machine[it->reg]))
+        continue;
+      if (victim == active.end() || it->weight < victim->weight || (it->weight == victim->weight && it->end > victim->end))
+        victim = it;
+    }
+    if (victim != active.end() && (victim->weight < current.weight || (victim->weight == current.weight && victim->end > current.end))) {
+      function.machine[current.reg] = function.machine[victim->reg];
+      spill(victim->reg);
+      *victim = current;
+    }
+    else
+      spill(current.reg);
+  }
+
+  // doubles live in memory
+  for (size_t reg = 0; reg < registers; reg++)
+    if (function.registers[reg] == ir::DOUBLE)
+      function.home[reg] = function.new_slot(8);
+}
@@ -0,0 +1,51 @@
+#ifndef __TIL_TARGETS_LINEAR_SCAN_H__
+#define __TIL_TARGETS_LINEAR_SCAN_H__
+
+#include <string>
+#include <vector>
+#include "targets/ir.h"
+
+namespace til {
+
+  /**
+   * Machine registers handed out by the allocator. Registers not listed
+   * here are left to the code generator as scratch registers.
+   */
+  struct register_file {
+    std::vector<std::string> names;
+    std::vector<bool> preserved; // callee-saved: survives calls
+    int pointer = 4;             // size of pointers (spill slots of pointer registers)
+  };
+
+  /**
+   * Linear-scan register allocation (Poletto and Sarkar) of the integer
+   * and pointer virtual registers of a function: live intervals come from a liveness
+   * analysis over the control flow graph; when registers run out, the
+   * interval with the fewest uses (weighted by loop depth) is spilled to
+   * a frame slot. Intervals that cross a call only get preserved
+   * registers. Double registers always get a frame slot.
+   */
+  class linear_scan {
+    const register_file &_registers;
+    size_t _allocated = 0, _spilled = 0;
+
+  public:
+    linear_scan(const register_file &registers) :
+        _registers(registers) {
+    }
+
+  public:
+    /** Fill in the machine registers and home slots of the function. */
+    void allocate(ir::function &function);
+
+    size_t allocated() const {
+      return _allocated;
+    }
+    size_t spilled() const {
+      return _spilled;
+    }
+  };
+
+} // til
+
+#endif
@@ -0,0 +1,262 @@
+#include <string>
+#include "targets/name_resolver.h"
+#include ".auto/all_nodes.h"  // automatically generated
+
+#include "til_parser.tab.h"
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (size_t i = 0; i < node->size(); i++) {
+    try {
+      node->node(i)->accept(this, lvl);
+    }
+    catch (const std::string &problem) {
+      std::cerr << node->node(i)->lineno() << ": " << problem << std::endl;
+      _errors++;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void til::name_resolver::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void til::name_resolver::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void til::name_resolver::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void til::name_resolver::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void til::name_resolver::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_not_node(cdk::not_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_add_node(cdk::add_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_sub_node(cdk::sub_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_mul_node(cdk::mul_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_div_node(cdk::div_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_mod_node(cdk::mod_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_lt_node(cdk::lt_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_le_node(cdk::le_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_ge_node(cdk::ge_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_gt_node(cdk::gt_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_ne_node(cdk::ne_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_eq_node(cdk::eq_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_and_node(cdk::and_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+void til::name_resolver::do_or_node(cdk::or_node *const node, int lvl) {
+  node->left()->accept(this, lvl + 2);
+  node->right()->accept(this, lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_variable_node(cdk::variable_node *const node, int lvl) {
+  const std::string &id = node->name();
+  auto symbol = _symtab.find(id);
+  if (!symbol)
+    throw std::string("undeclared variable '" + id + "'");
+  _bindings.bind(node, symbol);
+}
+
+void til::name_resolver::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl);
+}
+
+void til::name_resolver::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 4);
+  node->rvalue()->accept(this, lvl + 4);
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_block_node(til::block_node *const node, int lvl) {
+  _symtab.push(); // for block-local vars
+  resolve(node->declarations(), lvl + 2);
+  resolve(node->instructions(), lvl + 2);
+  _symtab.pop();
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_program_node(til::program_node *const node, int lvl) {
+  _symtab.insert("_main", til::make_symbol(node->type(), "_main", tPUBLIC));
+
+  _functions.push_back(node);
+  _symtab.push(); // scope of args
+  node->block()->accept(this, lvl + 2);
+  _symtab.pop();
+  _functions.pop_back();
+}
+
+void til::name_resolver::do_evaluation_node(til::evaluation_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+}
+
+void til::name_resolver::do_print_node(til::print_node *const node, int lvl) {
+  node->arguments()->accept(this, lvl + 2);
+}
+
+void til::name_resolver::do_read_node(til::read_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_loop_node(til::loop_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 4);
+  node->block()->accept(this, lvl + 4);
+}
+
+void til::name_resolver::do_stop_node(til::stop_node *const node, int lvl) {
+  // EMPTY
+}
+
+void til::name_resolver::do_next_node(til::next_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_if_node(til::if_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 4);
+  node->block()->accept(this, lvl + 4);
+}
+
+void til::name_resolver::do_if_else_node(til::if_else_node *const node, int lvl) {
+  node->condition()->accept(this, lvl + 4);
+  node->thenblock()->accept(this, lvl + 4);
+  node->elseblock()->accept(this, lvl + 4);
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_function_definition_node(til::function_definition_node *const node, int lvl) {
+  _functions.push_back(node);
+  _symtab.push(); // scope of args
+  resolve(node->arguments(), lvl + 4);
+  node->block()->accept(this, lvl + 2);
+  _symtab.pop();
+  _functions.pop_back();
+}
+
+void til::name_resolver::do_function_call_node(til::function_call_node *const node, int lvl) {
+  resolve(node->expression(), lvl + 2); // no expression means @ (recursive call)
+  resolve(node->arguments(), lvl + 2);
+}
+
+void til::name_resolver::do_return_node(til::return_node *const node, int lvl) {
+  resolve(node->retval(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
+  resolve(node->initializer(), lvl + 2); // the initializer does not see the new variable
+
+  // vars are typed by their initializers: the type checker will set the type
+  const std::string &id = node->identifier();
+  auto symbol = til::make_symbol(node->type(), id, node->qualifier());
+
+  auto previous = _symtab.find_local(id);
+  if (previous) {
+    if (previous->qualifier() != tFORWARD)
+      throw std::string("variable '" + id + "' redeclared");
+
+    symbol->qualifier(tPUBLIC);
+    _symtab.replace(id, symbol);
+    node->forward(previous); // the type checker will compare both types
+  }
+  else {
+    _symtab.insert(id, symbol);
+  }
+
+  node->symbol(symbol);
+  if (!_functions.empty())
+    _owners[symbol.get()] = _functions.back(); // globals have no frame
+}
+
+//---------------------------------------------------------------------------
+
+void til::name_resolver::do_nullptr_node(til::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+
+void til::name_resolver::do_index_node(til::index_node *const node, int lvl) {
+  node->base()->accept(this, lvl + 2);
+  node->index()->accept(this, lvl + 2);
+}
+
+void til::name_resolver::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
+  node->argument()->accept(this, lvl + 2);
+  if (!_functions.empty())
+    _bindings.set_frame_referenced(_functions.back()); // the memory is in the frame
+}
+
+void til::name_resolver::do_address_of_node(til::address_of_node *const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+  if (auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue())) {
+    auto symbol = _bindings.symbol(variable);
+    symbol->set_addressed(); // must stay in memory
+    auto owner = _owners.find(symbol.get());
+    if (owner != _owners.end())
+      _bindings.set_frame_referenced(owner->second);
+  }
+}
+
+void til::name_resolver::do_sizeof_node(til::sizeof_node *const node, int lvl) {
+  node->expression()->accept(this, lvl + 2);
+}
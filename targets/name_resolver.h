@@ -0,0 +1,60 @@
+#ifndef __TIL_TARGETS_NAME_RESOLVER_H__
+#define __TIL_TARGETS_NAME_RESOLVER_H__
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/bindings.h"
+#include "targets/scope_table.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace til {
+
+  /**
+   * Resolve names in a single pass: each declaration gets its symbol and
+   * each identifier occurrence is bound to the symbol it refers to. This
+   * is the only pass that looks names up in a symbol table.
+   */
+  class name_resolver: public basic_ast_visitor {
+    til::scope_table<til::symbol> &_symtab;
+    til::bindings &_bindings;
+
+    std::vector<const cdk::basic_node*> _functions; // enclosing function definitions (or the program)
+    std::unordered_map<const til::symbol*, const cdk::basic_node*> _owners; // function of each local or argument
+
+    size_t _errors;
+
+  public:
+    name_resolver(std::shared_ptr<cdk::compiler> compiler, til::scope_table<til::symbol> &symtab, til::bindings &bindings) :
+        basic_ast_visitor(compiler), _symtab(symtab), _bindings(bindings), _errors(0) {
+    }
+
+  public:
+    ~name_resolver() {
+      os().flush();
+    }
+
+  public:
+    /** Number of errors reported: types must not be checked if non-zero. */
+    size_t errors() const {
+      return _errors;
+    }
+
+  protected:
+    void resolve(cdk::basic_node *const node, int lvl) {
+      if (node)
+        node->accept(this, lvl);
+    }
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // til
+
+#endif
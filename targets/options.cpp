@@ -0,0 +1,36 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "targets/options.h"
+
+til::options::options() {
+  const char *flags = std::getenv("TIL_FLAGS");
+  if (!flags)
+    return;
+
+  std::istringstream iss(flags);
+  std::string flag;
+  while (iss >> flag) {
+    if (flag == "--stats")
+      _stats = true;
+    else if (flag == "--no-asm-comments")
+      _asm_comments = false;
+    else if (flag == "--no-peephole")
+      _peephole = false;
+    else if (flag == "--time-report")
+      _time_report = true;
+    else if (flag.rfind("--time-trace=", 0) == 0)
+      _time_trace = flag.substr(13);
+    else if (flag.rfind("--inline-threshold=", 0) == 0)
+      _inline_threshold = std::strtoul(flag.c_str() + 19, nullptr, 10);
+    else if (flag == "--inline-report")
+      _inline_report = true;
+    else
+      std::cerr << "TIL_FLAGS: unknown option '" << flag << "'" << std::endl;
+  }
+}
+
+const til::options &til::options::get() {
+  static options self;
+  return self;
+}
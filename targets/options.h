@@ -0,0 +1,72 @@
+#ifndef __TIL_TARGETS_OPTIONS_H__
+#define __TIL_TARGETS_OPTIONS_H__
+
+#include <cstddef>
+#include <string>
+
+namespace til {
+
+  /**
+   * TIL-specific compiler options.
+   *
+   * The command line is parsed by the CDK driver, which rejects options it
+   * does not know, so these are read from the TIL_FLAGS environment variable:
+   *
+   *   TIL_FLAGS="--stats" ./til --target asm file.til
+   */
+  class options {
+    bool _stats = false;
+    bool _asm_comments = true;
+    bool _peephole = true;
+    bool _time_report = false;
+    std::string _time_trace;
+    size_t _inline_threshold = 40;
+    bool _inline_report = false;
+
+  private:
+    options();
+
+  public:
+    static const options &get();
+
+  public:
+    /** Print compilation counters to stderr when a target finishes. */
+    bool stats() const {
+      return _stats;
+    }
+
+    /** Annotate the generated assembly with comments (--no-asm-comments). */
+    bool asm_comments() const {
+      return _asm_comments;
+    }
+
+    /** Rewrite redundant instruction sequences (disabled by --no-peephole). */
+    bool peephole() const {
+      return _peephole;
+    }
+
+    /** Print time and memory used by each phase and function (--time-report). */
+    bool time_report() const {
+      return _time_report;
+    }
+
+    /** File for a Chrome trace of the compilation (--time-trace=FILE). */
+    const std::string &time_trace() const {
+      return _time_trace;
+    }
+
+    /** Largest body (in syntax tree nodes) of an inlined function (--inline-threshold=N, 0 disables). */
+    size_t inline_threshold() const {
+      return _inline_threshold;
+    }
+
+    /** Tell, for each function, whether it was inlined, and why not (--inline-report). */
+    bool inline_report() const {
+      return _inline_report;
+    }
+
+  };
+
+} // til
+
+#endif
@@ -0,0 +1,31 @@
+#include <cstring>
+#include "targets/output_buffer.h"
+
+void til::output_buffer::reserve(size_t n) {
+  size_t used = size();
+  if (used + n <= _data.size())
+    return;
+
+  size_t capacity = _data.size();
+  while (used + n > capacity)
+    capacity *= 2;
+  _data.resize(capacity);
+  setp(_data.data(), _data.data() + _data.size());
+  pbump(used);
+}
+
+til::output_buffer::int_type til::output_buffer::overflow(int_type c) {
+  if (traits_type::eq_int_type(c, traits_type::eof()))
+    return traits_type::not_eof(c);
+  reserve(1);
+  *pptr() = traits_type::to_char_type(c);
+  pbump(1);
+  return c;
+}
+
+std::streamsize til::output_buffer::xsputn(const char *s, std::streamsize n) {
+  reserve(n);
+  std::memcpy(pptr(), s, n);
+  pbump(n);
+  return n;
+}
@@ -0,0 +1,47 @@
+#ifndef __TIL_TARGETS_OUTPUT_BUFFER_H__
+#define __TIL_TARGETS_OUTPUT_BUFFER_H__
+
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace til {
+
+  /**
+   * Stream buffer that keeps all the output of a compilation in memory, in
+   * a single growable buffer. Flushes (e.g., std::endl) cost nothing; the
+   * contents go to the real output in one write at the end.
+   */
+  class output_buffer: public std::streambuf {
+    std::vector<char> _data;
+
+  public:
+    output_buffer() : _data(64 * 1024) {
+      setp(_data.data(), _data.data() + _data.size());
+    }
+
+  public:
+    size_t size() const {
+      return pptr() - pbase();
+    }
+
+    /** Write everything collected so far to the given stream. */
+    void write_to(std::ostream &os) const {
+      os.write(pbase(), size());
+      os.flush();
+    }
+
+  protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override {
+      return 0; // nothing to flush until write_to
+    }
+
+  private:
+    void reserve(size_t n);
+  };
+
+} // til
+
+#endif
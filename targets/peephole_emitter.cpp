@@ -0,0 +1,148 @@
+#include "targets/peephole_emitter.h"
+#include "targets/stats.h"
+
+namespace {
+
+  typedef til::peephole_emitter::instruction instruction;
+  typedef til::peephole_emitter emitter;
+
+  // A rule matches a window of consecutive instructions (comments are
+  // skipped) and rewrites it in place: removed instructions become DEAD.
+  struct rule {
+    const char *name;
+    size_t length;
+    bool (*match)(instruction *const *window);
+    void (*rewrite)(instruction *const *window);
+  };
+
+  bool is_address(const instruction *instr) {
+    return instr->op == emitter::op_LOCAL || instr->op == emitter::op_ADDR;
+  }
+
+  void kill(instruction *instr) {
+    instr->op = emitter::op_DEAD;
+  }
+
+  const rule rules[] = {
+    // logical not feeding a branch: branch on the opposite condition
+    { "not before branch", 3,
+      [](instruction *const *w) {
+        return w[0]->op == emitter::op_INT && w[0]->value == 0 && w[1]->op == emitter::op_EQ &&
+               (w[2]->op == emitter::op_JZ || w[2]->op == emitter::op_JNZ);
+      },
+      [](instruction *const *w) {
+        kill(w[0]);
+        kill(w[1]);
+        w[2]->op = w[2]->op == emitter::op_JZ ? emitter::op_JNZ : emitter::op_JZ;
+      } },
+
+    // assignments used as statements: the value need not be kept
+    { "assignment as statement", 4,
+      [](instruction *const *w) {
+        return w[0]->op == emitter::op_DUP32 && is_address(w[1]) && w[2]->op == emitter::op_STINT &&
+               w[3]->op == emitter::op_TRASH && w[3]->value == 4;
+      },
+      [](instruction *const *w) {
+        kill(w[0]);
+        kill(w[3]);
+      } },
+    { "double assignment as statement", 4,
+      [](instruction *const *w) {
+        return w[0]->op == emitter::op_DUP64 && is_address(w[1]) && w[2]->op == emitter::op_STDOUBLE &&
+               w[3]->op == emitter::op_TRASH && w[3]->value == 8;
+      },
+      [](instruction *const *w) {
+        kill(w[0]);
+        kill(w[3]);
+      } },
+
+    // jumps to the very next instruction
+    { "jump to next label", 2,
+      [](instruction *const *w) {
+        return w[0]->op == emitter::op_JMP && w[1]->op == emitter::op_LABEL && w[0]->text == w[1]->text;
+      },
+      [](instruction *const *w) {
+        kill(w[0]);
+      } },
+    { "jump to next aligned label", 3,
+      [](instruction *const *w) {
+        return w[0]->op == emitter::op_JMP && w[1]->op == emitter::op_ALIGN && w[2]->op == emitter::op_LABEL &&
+               w[0]->text == w[2]->text;
+      },
+      [](instruction *const *w) {
+        kill(w[0]);
+      } },
+
+    // integer constants converted at run time
+    { "constant conversion", 2,
+      [](instruction *const *w) {
+        return w[0]->op == emitter::op_INT && w[1]->op == emitter::op_I2D;
+      },
+      [](instruction *const *w) {
+        w[0]->op = emitter::op_DOUBLE;
+        w[0]->number = w[0]->value;
+        kill(w[1]);
+      } },
+  };
+
+} // anonymous
+
+void til::peephole_emitter::optimize() {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+
+    std::vector<instruction*> live;
+    for (auto &instr : _code)
+      if (instr.op != op_DEAD && instr.op != op_COMMENT)
+        live.push_back(&instr);
+
+    for (size_t i = 0; i < live.size(); i++) {
+      for (auto &r : rules) {
+        if (i + r.length <= live.size() && r.match(&live[i])) {
+          r.rewrite(&live[i]);
+          stats::add(std::string("peephole: ") + r.name);
+          changed = true;
+          i += r.length - 1; // the window is no longer valid
+          break;
+        }
+      }
+    }
+  }
+}
+
+void til::peephole_emitter::flush() {
+  if (_optimize)
+    optimize();
+  for (auto &instr : _code)
+    emit(instr);
+  _code.clear();
+}
+
+void til::peephole_emitter::emit(const instruction &instr) {
+  switch (instr.op) {
+#define TIL_PLAIN(op) case op_##op: cdk::postfix_ix86_emitter::op(); break;
+#define TIL_INT(op) case op_##op: cdk::postfix_ix86_emitter::op(instr.value); break;
+#define TIL_STRING(op) case op_##op: cdk::postfix_ix86_emitter::op(instr.text); break;
+#define TIL_DOUBLE(op) case op_##op: cdk::postfix_ix86_emitter::op(instr.number); break;
+    TIL_PEEPHOLE_PLAIN_OPS(TIL_PLAIN)
+    TIL_PEEPHOLE_INT_OPS(TIL_INT)
+    TIL_PEEPHOLE_STRING_OPS(TIL_STRING)
+    TIL_PEEPHOLE_DOUBLE_OPS(TIL_DOUBLE)
+#undef TIL_PLAIN
+#undef TIL_INT
+#undef TIL_STRING
+#undef TIL_DOUBLE
+    case op_RET:
+      cdk::postfix_ix86_emitter::RET();
+      break;
+    case op_GLOBAL:
+      cdk::postfix_ix86_emitter::GLOBAL(instr.text, instr.type);
+      break;
+    case op_COMMENT:
+      *_output->ostream() << "        ;; " << instr.text << '\n';
+      break;
+    case op_DEAD:
+      break;
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef __TIL_TARGETS_PEEPHOLE_EMITTER_H__
+#define __TIL_TARGETS_PEEPHOLE_EMITTER_H__
+
+#include <string>
+#include <vector>
+#include <cdk/emitters/postfix_ix86_emitter.h>
+
+// postfix operations buffered by the peephole emitter, by kind of argument
+#define TIL_PEEPHOLE_PLAIN_OPS(X) \
+  X(ALIGN) X(TEXT) X(RODATA) X(DATA) X(BSS) \
+  X(NEG) X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(AND) X(OR) \
+  X(EQ) X(NE) X(LT) X(LE) X(GT) X(GE) \
+  X(DNEG) X(DADD) X(DSUB) X(DMUL) X(DDIV) X(DCMP) X(I2D) X(D2I) \
+  X(LDINT) X(LDDOUBLE) X(STINT) X(STDOUBLE) X(DUP32) X(DUP64) \
+  X(SP) X(ALLOC) X(BRANCH) X(LEAVE) \
+  X(STFVAL32) X(STFVAL64) X(LDFVAL32) X(LDFVAL64)
+#define TIL_PEEPHOLE_INT_OPS(X) \
+  X(INT) X(SINT) X(SBYTE) X(SALLOC) X(ENTER) X(TRASH) X(LOCAL)
+#define TIL_PEEPHOLE_STRING_OPS(X) \
+  X(LABEL) X(ADDR) X(SADDR) X(CALL) X(EXTERN) X(SSTRING) \
+  X(JMP) X(JZ) X(JNZ) X(JEQ) X(JNE) X(JLT) X(JLE) X(JGT) X(JGE)
+#define TIL_PEEPHOLE_DOUBLE_OPS(X) \
+  X(DOUBLE) X(SDOUBLE)
+
+namespace til {
+
+  /**
+   * Postfix emitter that buffers the instructions of each function and
+   * rewrites redundant sequences (see the rule table in the .cpp file)
+   * before handing them to the ix86 emitter. Comments go through the
+   * buffer too, so that they stay in place.
+   */
+  class peephole_emitter: public cdk::postfix_ix86_emitter {
+  public:
+    enum opcode {
+#define TIL_OPCODE(op) op_##op,
+      TIL_PEEPHOLE_PLAIN_OPS(TIL_OPCODE)
+      TIL_PEEPHOLE_INT_OPS(TIL_OPCODE)
+      TIL_PEEPHOLE_STRING_OPS(TIL_OPCODE)
+      TIL_PEEPHOLE_DOUBLE_OPS(TIL_OPCODE)
+#undef TIL_OPCODE
+      op_RET, op_GLOBAL, op_COMMENT,
+      op_DEAD // removed by a rewrite
+    };
+
+    struct instruction {
+      opcode op;
+      int value;
+      double number;
+      std::string text, type;
+
+      instruction(opcode op, int value = 0, double number = 0, const std::string &text = "", const std::string &type = "") :
+          op(op), value(value), number(number), text(text), type(type) {
+      }
+    };
+
+  private:
+    std::shared_ptr<cdk::compiler> _output;
+    std::vector<instruction> _code;
+    bool _optimize;
+
+  public:
+    peephole_emitter(std::shared_ptr<cdk::compiler> compiler, bool optimize) :
+        cdk::postfix_ix86_emitter(compiler), _output(compiler), _optimize(optimize) {
+    }
+
+    ~peephole_emitter() {
+      flush();
+    }
+
+  public:
+    /** Assembly comment, kept in order with the buffered instructions. */
+    void comment(const std::string &text) {
+      _code.emplace_back(op_COMMENT, 0, 0, text);
+    }
+
+    /** Optimize and emit the buffered instructions. */
+    void flush();
+
+  public:
+#define TIL_PLAIN(op) void op() override { _code.emplace_back(op_##op); }
+#define TIL_INT(op) void op(int value) override { _code.emplace_back(op_##op, value); }
+#define TIL_STRING(op) void op(const std::string &text) override { _code.emplace_back(op_##op, 0, 0, text); }
+#define TIL_DOUBLE(op) void op(double number) override { _code.emplace_back(op_##op, 0, number); }
+    TIL_PEEPHOLE_PLAIN_OPS(TIL_PLAIN)
+    TIL_PEEPHOLE_INT_OPS(TIL_INT)
+    TIL_PEEPHOLE_STRING_OPS(TIL_STRING)
+    TIL_PEEPHOLE_DOUBLE_OPS(TIL_DOUBLE)
+#undef TIL_PLAIN
+#undef TIL_INT
+#undef TIL_STRING
+#undef TIL_DOUBLE
+
+    void GLOBAL(const std::string &label, const std::string &type) override {
+      _code.emplace_back(op_GLOBAL, 0, 0, label, type);
+    }
+
+    /** A function ends here: its code can be optimized and emitted. */
+    void RET() override {
+      _code.emplace_back(op_RET);
+      flush();
+    }
+
+  private:
+    void optimize();
+    void emit(const instruction &instr);
+  };
+
+} // til
+
+#endif
@@ -3,9 +3,20 @@
 
 #include <cdk/targets/basic_target.h>
 #include <cdk/ast/basic_node.h>
+#include "targets/name_resolver.h"
+#include "targets/type_checker.h"
+#include "targets/constant_folder.h"
+#include "targets/callee_resolver.h"
+#include "targets/inliner.h"
 #include "targets/postfix_writer.h"
+#include "targets/peephole_emitter.h"
+#include "targets/options.h"
+#include "targets/stats.h"
+#include "targets/types.h"
+#include "targets/output_buffer.h"
+#include "targets/time_report.h"
+#include "arena.h"
 
-#include <cdk/emitters/postfix_ix86_emitter.h>
 
 namespace til {
 
@@ -19,16 +30,100 @@ namespace til {
 
   public:
     bool evaluate(std::shared_ptr<cdk::compiler> compiler) {
-      // this symbol table will be used to check identifiers
-      // during code generation
-      cdk::symbol_table<til::symbol> symtab;
+      // the driver has already scanned and parsed the input
+      time_report::since_start("phase", "startup and parsing");
 
-      // this is the backend postfix machine
-      cdk::postfix_ix86_emitter pf(compiler);
+      // name resolution: every identifier is bound to its symbol once,
+      // so later passes never look names up
+      til::bindings bindings;
+      {
+        time_report::scope phase("phase", "name resolution");
+        til::scope_table<til::symbol> symtab;
+        name_resolver resolver(compiler, symtab, bindings);
+        compiler->ast()->accept(&resolver, 0);
+        stats::add("bound identifiers", bindings.size());
+        stats::add("distinct identifiers", symtab.identifiers());
+        if (resolver.errors())
+          return false;
+      }
 
-      // generate assembly code from the syntax tree
-      postfix_writer writer(compiler, symtab, pf);
-      compiler->ast()->accept(&writer, 0);
+      // semantic analysis: types are computed once and stored in the
+      // syntax tree for the code generator to read
+      type_checker checker(compiler, bindings);
+      {
+        time_report::scope phase("phase", "type checking");
+        compiler->ast()->accept(&checker, 0);
+      }
+      stats::add("type checker visits", checker.visits());
+      if (checker.errors())
+        return false;
+
+      // constant expressions and algebraic identities are simplified
+      // once the types of all expressions are known
+      constant_folder folder(compiler);
+      {
+        time_report::scope phase("phase", "constant folding");
+        compiler->ast()->accept(&folder, 0);
+      }
+
+      // local function variables that always hold the same function
+      callee_resolver callees(compiler, bindings);
+      {
+        time_report::scope phase("phase", "callee resolution");
+        compiler->ast()->accept(&callees, 0);
+        callees.solve();
+      }
+
+      // small functions are generated in place of their calls
+      inliner inlining(compiler, bindings, options::get().inline_threshold());
+      {
+        time_report::scope phase("phase", "inlining");
+        compiler->ast()->accept(&inlining, 0);
+        inlining.solve();
+      }
+      if (options::get().inline_report())
+        inlining.report(std::cerr);
+
+      // stack frame sizes of all functions (with the bodies inlined in them), computed once
+      frame_size_calculator frames(compiler, &inlining);
+      {
+        time_report::scope phase("phase", "frame sizing");
+        compiler->ast()->accept(&frames, 0);
+      }
+
+      // the assembly code is collected in memory and written at once
+      output_buffer buffer;
+      std::ostream &out = *compiler->ostream();
+      std::streambuf *file = out.rdbuf(&buffer);
+      {
+        time_report::scope phase("phase", "code generation");
+
+        // this is the backend postfix machine (behind the peephole optimizer)
+        peephole_emitter pf(compiler, options::get().peephole());
+
+        // generate assembly code from the syntax tree
+        postfix_writer writer(compiler, bindings, checker, frames, folder, callees, inlining, pf);
+        compiler->ast()->accept(&writer, 0);
+        writer.emit_constants(); // the literals used by all functions
+      }
+      out.rdbuf(file);
+      {
+        time_report::scope phase("phase", "output");
+        buffer.write_to(out);
+      }
+      stats::add("assembly bytes", buffer.size());
+
+      if (options::get().stats()) {
+        stats::add("ast arena bytes used", arena::ast().used());
+        stats::add("ast arena bytes reserved", arena::ast().reserved());
+        stats::add("interned types", types::count());
+        stats::report(std::cerr);
+      }
+
+      if (options::get().time_report())
+        time_report::report(std::cerr);
+      if (!options::get().time_trace().empty() && !time_report::write_trace(options::get().time_trace()))
+        std::cerr << "cannot write time trace to '" << options::get().time_trace() << "'" << std::endl;
 
       return true;
     }
@@ -1,14 +1,168 @@
+#include <algorithm>
 #include <string>
 #include <sstream>
-#include "targets/type_checker.h"
 #include "targets/postfix_writer.h"
-#include "targets/frame_size_calculator.h"
+#include "targets/stats.h"
+#include "targets/time_report.h"
 #include ".auto/all_nodes.h"  // automatically generated
 
 #include "til_parser.tab.h"
 
 //---------------------------------------------------------------------------
 
+bool til::postfix_writer::emit_folded(cdk::expression_node *const node, int lvl) {
+  auto replacement = _folder.folded(node);
+  if (replacement == node)
+    return false;
+  replacement->accept(this, lvl);
+  return true;
+}
+
+void til::postfix_writer::emit_scaled(cdk::expression_node *const offset, size_t size, int lvl) {
+  int value;
+  if (_folder.integer(offset, value)) {
+    _pf.INT(static_cast<int>(static_cast<unsigned>(value) * size));
+    return;
+  }
+  offset->accept(this, lvl);
+  if (size != 1) {
+    _pf.INT(size);
+    _pf.MUL();
+  }
+}
+
+void til::postfix_writer::emit_constants() {
+  // with the texts reversed and sorted, a string ending others is right before them
+  std::vector<std::pair<std::string, int>> strings;
+  for (auto &[text, lbl] : _strings)
+    strings.emplace_back(std::string(text.rbegin(), text.rend()), lbl);
+  std::sort(strings.begin(), strings.end());
+
+  for (auto it = strings.rbegin(); it != strings.rend();) {
+    const std::string &reversed = it->first;
+    std::string text(reversed.rbegin(), reversed.rend());
+    _pf.RODATA(); // strings are DATA readonly
+    _pf.ALIGN();
+    size_t done = 0;
+    for (; it != strings.rend() && reversed.compare(0, it->first.size(), it->first) == 0; ++it) {
+      size_t start = text.size() - it->first.size();
+      for (; done < start; done++)
+        _pf.SBYTE(text[done]);
+      _pf.LABEL(mklbl(it->second));
+    }
+    _pf.SSTRING(text.substr(done));
+  }
+
+  for (auto &[bits, lbl] : _doubles) {
+    double number;
+    std::memcpy(&number, &bits, sizeof(number));
+    _pf.RODATA();
+    _pf.ALIGN();
+    _pf.LABEL(mklbl(lbl));
+    _pf.SDOUBLE(number);
+  }
+
+  stats::add("pooled strings", _strings.size());
+  stats::add("pooled doubles", _doubles.size());
+}
+
+void til::postfix_writer::emit_comparison(cdk::binary_operation_node *const node, int lvl) {
+  bool real = node->left()->is_typed(cdk::TYPE_DOUBLE) || node->right()->is_typed(cdk::TYPE_DOUBLE);
+
+  node->left()->accept(this, lvl + 2);
+  if (real && node->left()->is_typed(cdk::TYPE_INT))
+    _pf.I2D();
+
+  node->right()->accept(this, lvl + 2);
+  if (real && node->right()->is_typed(cdk::TYPE_INT))
+    _pf.I2D();
+
+  if (real) {
+    _pf.DCMP();
+    _pf.INT(0);
+  }
+}
+
+void til::postfix_writer::emit_branch(cdk::expression_node *const node, bool when, int lbl, int lvl) {
+  auto expression = _folder.folded(node);
+
+  int value;
+  if (_folder.integer(expression, value)) {
+    if ((value != 0) == when)
+      _pf.JMP(mklbl(lbl));
+    return;
+  }
+
+  if (auto negation = dynamic_cast<cdk::not_node*>(expression)) {
+    emit_branch(negation->argument(), !when, lbl, lvl);
+    return;
+  }
+
+  // jump chains: the left operand may decide the result alone
+  auto conjunction = dynamic_cast<cdk::and_node*>(expression);
+  auto disjunction = dynamic_cast<cdk::or_node*>(expression);
+  if (conjunction || disjunction) {
+    auto binary = static_cast<cdk::binary_operation_node*>(expression);
+    bool decides = disjunction != nullptr; // value of the left operand that decides the result
+    if (when == decides) {
+      emit_branch(binary->left(), when, lbl, lvl + 2);
+      emit_branch(binary->right(), when, lbl, lvl + 2);
+    }
+    else {
+      int skip = ++_lbl;
+      emit_branch(binary->left(), decides, skip, lvl + 2);
+      emit_branch(binary->right(), when, lbl, lvl + 2);
+      _pf.LABEL(mklbl(skip));
+    }
+    return;
+  }
+
+  // comparisons jump directly (with the opposite condition, to jump when false)
+  auto binary = dynamic_cast<cdk::binary_operation_node*>(expression);
+  if (dynamic_cast<cdk::eq_node*>(expression) || dynamic_cast<cdk::ne_node*>(expression)) {
+    emit_comparison(binary, lvl);
+    if (when == (dynamic_cast<cdk::eq_node*>(expression) != nullptr))
+      _pf.JEQ(mklbl(lbl));
+    else
+      _pf.JNE(mklbl(lbl));
+    return;
+  }
+  if (dynamic_cast<cdk::lt_node*>(expression) || dynamic_cast<cdk::ge_node*>(expression)) {
+    emit_comparison(binary, lvl);
+    if (when == (dynamic_cast<cdk::lt_node*>(expression) != nullptr))
+      _pf.JLT(mklbl(lbl));
+    else
+      _pf.JGE(mklbl(lbl));
+    return;
+  }
+  if (dynamic_cast<cdk::gt_node*>(expression) || dynamic_cast<cdk::le_node*>(expression)) {
+    emit_comparison(binary, lvl);
+    if (when == (dynamic_cast<cdk::gt_node*>(expression) != nullptr))
+      _pf.JGT(mklbl(lbl));
+    else
+      _pf.JLE(mklbl(lbl));
+    return;
+  }
+
+  expression->accept(this, lvl);
+  if (when)
+    _pf.JNZ(mklbl(lbl));
+  else
+    _pf.JZ(mklbl(lbl));
+}
+
+void til::postfix_writer::emit_boolean(cdk::expression_node *const node, int lvl) {
+  int lbl1, lbl2;
+  emit_branch(node, false, lbl1 = ++_lbl, lvl);
+  _pf.INT(1);
+  _pf.JMP(mklbl(lbl2 = ++_lbl));
+  _pf.LABEL(mklbl(lbl1));
+  _pf.INT(0);
+  _pf.LABEL(mklbl(lbl2));
+}
+
+//---------------------------------------------------------------------------
+
 void til::postfix_writer::do_nil_node(cdk::nil_node *const node, int lvl) {
   // EMPTY
 }
@@ -26,7 +180,6 @@ void til::postfix_writer::do_sequence_node(cdk::sequence_node *const node, int l
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_integer_node(cdk::integer_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   if (_inFunctionBody)
     _pf.INT(node->value()); // integer literal is on the stack: push an integer
   else
@@ -34,71 +187,62 @@ void til::postfix_writer::do_integer_node(cdk::integer_node *const node, int lvl
 }
 
 void til::postfix_writer::do_double_node(cdk::double_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  if (_inFunctionBody)
-    _pf.DOUBLE(node->value()); // load number to the stack
+  if (_inFunctionBody) {
+    _pf.ADDR(mklbl(pooled(node->value()))); // load number from the constant pool
+    _pf.LDDOUBLE();
+  }
   else
     _pf.SDOUBLE(node->value()); // double is on the DATA segment
 }
 
 void til::postfix_writer::do_string_node(cdk::string_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  int lbl1;
-
-  /* generate the string */
-  _pf.RODATA(); // strings are DATA readonly
-  _pf.ALIGN(); // make sure we are aligned
-  _pf.LABEL(mklbl(lbl1 = ++_lbl)); // give the string a name
-  _pf.SSTRING(node->value()); // output string characters
-
-  if (_inFunctionBody) {
-    /* leave the address on the stack */
-    _pf.TEXT(); // return to the TEXT segment
-    _pf.ADDR(mklbl(lbl1)); // the string to be printed
-  }
-  else {
-    // global variable initializer
-    _pf.DATA();
-    _pf.SADDR(mklbl(lbl1));
-  }
+  if (_inFunctionBody)
+    _pf.ADDR(mklbl(pooled(node->value()))); // leave the address on the stack
+  else
+    _pf.SADDR(mklbl(pooled(node->value()))); // global variable initializer
 }
 
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
+
   node->argument()->accept(this, lvl); // determine the value
   _pf.NEG(); // 2-complement
 }
 
 void til::postfix_writer::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
+
   node->argument()->accept(this, lvl); // determine the value
 }
 
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_add_node(cdk::add_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
 
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT)) {
-    _pf.I2D();
-  }
-  else if (node->is_typed(cdk::TYPE_POINTER) && node->left()->is_typed(cdk::TYPE_INT)) {
+  if (node->is_typed(cdk::TYPE_POINTER) && node->left()->is_typed(cdk::TYPE_INT)) {
     auto node_type = cdk::reference_type::cast(node->type());
-    _pf.INT(node_type->referenced()->size());
-    _pf.MUL();
+    emit_scaled(node->left(), node_type->referenced()->size(), lvl + 2);
   }
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT)) {
-    _pf.I2D();
+  else {
+    node->left()->accept(this, lvl + 2);
+    if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
+      _pf.I2D();
   }
-  else if (node->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_INT)) {
+
+  if (node->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_INT)) {
     auto node_type = cdk::reference_type::cast(node->type());
-    _pf.INT(node_type->referenced()->size());
-    _pf.MUL();
+    emit_scaled(node->right(), node_type->referenced()->size(), lvl + 2);
+  }
+  else {
+    node->right()->accept(this, lvl + 2);
+    if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
+      _pf.I2D();
   }
 
   if (node->is_typed(cdk::TYPE_DOUBLE))
@@ -108,26 +252,27 @@ void til::postfix_writer::do_add_node(cdk::add_node *const node, int lvl) {
 }
 
 void til::postfix_writer::do_sub_node(cdk::sub_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
 
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT)) {
-    _pf.I2D();
-  }
-  else if (node->is_typed(cdk::TYPE_POINTER) && node->left()->is_typed(cdk::TYPE_INT)) {
+  if (node->is_typed(cdk::TYPE_POINTER) && node->left()->is_typed(cdk::TYPE_INT)) {
     auto node_type = cdk::reference_type::cast(node->type());
-    _pf.INT(node_type->referenced()->size());
-    _pf.MUL();
+    emit_scaled(node->left(), node_type->referenced()->size(), lvl + 2);
   }
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT)) {
-    _pf.I2D();
+  else {
+    node->left()->accept(this, lvl + 2);
+    if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
+      _pf.I2D();
   }
-  else if (node->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_INT)) {
+
+  if (node->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_INT)) {
     auto node_type = cdk::reference_type::cast(node->type());
-    _pf.INT(node_type->referenced()->size());
-    _pf.MUL();
+    emit_scaled(node->right(), node_type->referenced()->size(), lvl + 2);
+  }
+  else {
+    node->right()->accept(this, lvl + 2);
+    if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
+      _pf.I2D();
   }
 
   if (node->is_typed(cdk::TYPE_DOUBLE))
@@ -143,7 +288,8 @@ void til::postfix_writer::do_sub_node(cdk::sub_node *const node, int lvl) {
 }
 
 void til::postfix_writer::do_mul_node(cdk::mul_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
 
   node->left()->accept(this, lvl + 2);
   if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
@@ -160,7 +306,8 @@ void til::postfix_writer::do_mul_node(cdk::mul_node *const node, int lvl) {
 }
 
 void til::postfix_writer::do_div_node(cdk::div_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
 
   node->left()->accept(this, lvl + 2);
   if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
@@ -177,174 +324,96 @@ void til::postfix_writer::do_div_node(cdk::div_node *const node, int lvl) {
 }
 
 void til::postfix_writer::do_mod_node(cdk::mod_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
+
   node->left()->accept(this, lvl + 2);
   node->right()->accept(this, lvl + 2);
   _pf.MOD();
 }
 
 void til::postfix_writer::do_lt_node(cdk::lt_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  if (node->is_typed(cdk::TYPE_DOUBLE)) {
-    _pf.DCMP();
-    _pf.INT(0);
-  }
+  if (emit_folded(node, lvl))
+    return;
 
+  emit_comparison(node, lvl);
   _pf.LT();
 }
 
 void til::postfix_writer::do_le_node(cdk::le_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  if (node->is_typed(cdk::TYPE_DOUBLE)) {
-    _pf.DCMP();
-    _pf.INT(0);
-  }
+  if (emit_folded(node, lvl))
+    return;
 
+  emit_comparison(node, lvl);
   _pf.LE();
 }
 
 void til::postfix_writer::do_ge_node(cdk::ge_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  if (node->is_typed(cdk::TYPE_DOUBLE)) {
-    _pf.DCMP();
-    _pf.INT(0);
-  }
+  if (emit_folded(node, lvl))
+    return;
 
+  emit_comparison(node, lvl);
   _pf.GE();
 }
 
 void til::postfix_writer::do_gt_node(cdk::gt_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  if (node->is_typed(cdk::TYPE_DOUBLE)) {
-    _pf.DCMP();
-    _pf.INT(0);
-  }
+  if (emit_folded(node, lvl))
+    return;
 
+  emit_comparison(node, lvl);
   _pf.GT();
 }
 
 void til::postfix_writer::do_ne_node(cdk::ne_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  if (node->is_typed(cdk::TYPE_DOUBLE)) {
-    _pf.DCMP();
-    _pf.INT(0);
-  }
+  if (emit_folded(node, lvl))
+    return;
 
+  emit_comparison(node, lvl);
   _pf.NE();
 }
 
 void til::postfix_writer::do_eq_node(cdk::eq_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  node->left()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  node->right()->accept(this, lvl + 2);
-  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
-    _pf.I2D();
-
-  if (node->is_typed(cdk::TYPE_DOUBLE)) {
-    _pf.DCMP();
-    _pf.INT(0);
-  }
+  if (emit_folded(node, lvl))
+    return;
 
+  emit_comparison(node, lvl);
   _pf.EQ();
 }
 
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_not_node(cdk::not_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (emit_folded(node, lvl))
+    return;
+
+  if (dynamic_cast<cdk::and_node*>(node->argument()) || dynamic_cast<cdk::or_node*>(node->argument())) {
+    emit_boolean(node, lvl);
+    return;
+  }
+
   node->argument()->accept(this, lvl + 2);
   _pf.INT(0);
   _pf.EQ();
 }
 
 void til::postfix_writer::do_and_node(cdk::and_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  int lbl;
-  node->left()->accept(this, lvl + 2);
-  _pf.INT(0);
-  _pf.GT();
-  _pf.DUP32();
-  _pf.JZ(mklbl(lbl = ++_lbl));
-  node->right()->accept(this, lvl + 2);
-  _pf.INT(0);
-  _pf.GT();
-  _pf.AND();
-  _pf.ALIGN();
-  _pf.LABEL(mklbl(lbl));
+  if (emit_folded(node, lvl))
+    return;
+
+  emit_boolean(node, lvl);
 }
 
 void til::postfix_writer::do_or_node(cdk::or_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  int lbl;
-  node->left()->accept(this, lvl + 2);
-  _pf.INT(0);
-  _pf.GT();
-  _pf.DUP32();
-  _pf.JNZ(mklbl(lbl = ++_lbl));
-  node->right()->accept(this, lvl + 2);
-  _pf.INT(0);
-  _pf.GT();
-  _pf.OR();
-  _pf.ALIGN();
-  _pf.LABEL(mklbl(lbl));
+  if (emit_folded(node, lvl))
+    return;
+
+  emit_boolean(node, lvl);
 }
 
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_variable_node(cdk::variable_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  const std::string &id = node->name();
-  auto symbol = _symtab.find(id);
+  auto symbol = _bindings.symbol(node);
 
   if (symbol->is_typed(cdk::TYPE_FUNCTIONAL)) {
     set_function_symbol(symbol); // advise that a function symbol has been found
@@ -358,7 +427,6 @@ void til::postfix_writer::do_variable_node(cdk::variable_node *const node, int l
 }
 
 void til::postfix_writer::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   if (node->is_typed(cdk::TYPE_FUNCTIONAL)) {
     node->lvalue()->accept(this, lvl);
     // no action needed
@@ -375,7 +443,6 @@ void til::postfix_writer::do_rvalue_node(cdk::rvalue_node *const node, int lvl)
 }
 
 void til::postfix_writer::do_assignment_node(cdk::assignment_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   if (node->is_typed(cdk::TYPE_FUNCTIONAL)) {
     node->rvalue()->accept(this, lvl + 2); // determine the new function
 
@@ -430,45 +497,38 @@ void til::postfix_writer::do_assignment_node(cdk::assignment_node *const node, i
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_block_node(til::block_node *const node, int lvl) {
-  _symtab.push(); // for block-local vars
+  int offset = _offset;
   if (node->declarations())
     node->declarations()->accept(this, lvl + 2);
   if (node->instructions())
     node->instructions()->accept(this, lvl + 2);
-  _symtab.pop();
+  _offset = offset; // slots of block-local vars are reused by later blocks
 }
 
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_program_node(til::program_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  auto function = new_symbol();
-  // _functions_to_declare.erase("_main");  // just in case
-  reset_new_symbol();
+  auto function = til::make_symbol(node->type(), "_main", tPUBLIC);
+  time_report::scope timing("function", "_main");
   _functions.push(function);
+  _referencedFrames.push(_bindings.frame_referenced(node));
 
   _bodyRetLabel.push(++_lbl);
 
-  _symtab.push(); // scope of args
-
   // generate the main function (RTS mandates that its name be "_main")
   _pf.TEXT();
   _pf.ALIGN();
   _pf.GLOBAL("_main", _pf.FUNC());
   _pf.LABEL("_main");
 
-  // compute stack size to be reserved for local variables
-  frame_size_calculator lsc(_compiler, _symtab, _functions);
-  node->accept(&lsc, lvl);
-  _pf.ENTER(lsc.localsize()); // total stack size reserved for local variables
+  _pf.ENTER(_frames.localsize(node)); // total stack size reserved for local variables
 
   _offset = 0; // prepare for local variable
 
   _inFunctionBody++;
-  os() << "        ;; before body " << std::endl;
+  comment("before body");
   node->block()->accept(this, lvl);
-  os() << "        ;; after body " << std::endl;
+  comment("after body");
   _inFunctionBody--;
 
   // end the main function
@@ -477,9 +537,10 @@ void til::postfix_writer::do_program_node(til::program_node *const node, int lvl
   _pf.RET();
   _bodyRetLabel.pop();
 
-  _symtab.pop(); // scope of arguments
-
   _functions.pop();
+  _referencedFrames.pop();
+
+  emit_nested(lvl);
 
   // declare external functions
   for (std::string s : _functions_to_declare)
@@ -489,7 +550,6 @@ void til::postfix_writer::do_program_node(til::program_node *const node, int lvl
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_evaluation_node(til::evaluation_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   node->argument()->accept(this, lvl);
   _pf.TRASH(node->argument()->type()->size());
 }
@@ -529,8 +589,6 @@ void til::postfix_writer::do_print_node(til::print_node *const node, int lvl) {
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_read_node(til::read_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   if (node->is_typed(cdk::TYPE_DOUBLE)) {
     _functions_to_declare.insert("readd");
     _pf.CALL("readd");
@@ -546,16 +604,16 @@ void til::postfix_writer::do_read_node(til::read_node *const node, int lvl) {
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_loop_node(til::loop_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   _loopTest.push_back(++_lbl);
   _loopEnd.push_back(++_lbl);
+  int body = ++_lbl;
 
-  _pf.LABEL(mklbl(_loopTest.back()));
-  node->condition()->accept(this, lvl);
-  _pf.JZ(mklbl(_loopEnd.back()));
-  node->block()->accept(this, lvl + 2);
+  // rotated loop: the only test of the condition is after the body, where the entry jumps to
   _pf.JMP(mklbl(_loopTest.back()));
+  _pf.LABEL(mklbl(body));
+  node->block()->accept(this, lvl + 2);
+  _pf.LABEL(mklbl(_loopTest.back()));
+  emit_branch(node->condition(), true, body, lvl);
   _pf.LABEL(mklbl(_loopEnd.back()));
 
   _loopTest.pop_back();
@@ -593,19 +651,15 @@ void til::postfix_writer::do_next_node(til::next_node *const node, int lvl) {
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_if_node(til::if_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   int lbl1;
-  node->condition()->accept(this, lvl);
-  _pf.JZ(mklbl(lbl1 = ++_lbl));
+  emit_branch(node->condition(), false, lbl1 = ++_lbl, lvl);
   node->block()->accept(this, lvl + 2);
   _pf.LABEL(mklbl(lbl1));
 }
 
 void til::postfix_writer::do_if_else_node(til::if_else_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   int lbl1, lbl2;
-  node->condition()->accept(this, lvl);
-  _pf.JZ(mklbl(lbl1 = ++_lbl));
+  emit_branch(node->condition(), false, lbl1 = ++_lbl, lvl);
   node->thenblock()->accept(this, lvl + 2);
   _pf.JMP(mklbl(lbl2 = ++_lbl));
   _pf.LABEL(mklbl(lbl1));
@@ -616,21 +670,34 @@ void til::postfix_writer::do_if_else_node(til::if_else_node *const node, int lvl
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_function_definition_node(til::function_definition_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   auto function = function_symbol();
   if (function)
     reset_function_symbol();
   else
     function = til::make_symbol(node->type(), mklbl(++_lbl), tPRIVATE);
+  _literals[node] = function;
 
-  _functions.push(function);
+  if (_inFunctionBody) {
+    _nested.emplace_back(node, function); // the literal is just its address
+  }
+  else if (_inliner.removed(node)) {
+    // EMPTY: inlined at all its calls
+  }
+  else {
+    emit_function(node, function, lvl);
+    emit_nested(lvl);
+  }
 
-  int functionEndLabel = ++_lbl;
+  set_function_symbol(function); // advise that a function symbol has been defined
+}
 
-  _pf.JMP(mklbl(functionEndLabel));
+void til::postfix_writer::emit_function(til::function_definition_node *const node, std::shared_ptr<til::symbol> function, int lvl) {
+  time_report::scope timing("function", [&] {
+    return function->name() + " (line " + std::to_string(node->lineno()) + ")";
+  });
 
-  _symtab.push(); // scope of args
+  _functions.push(function);
+  _referencedFrames.push(_bindings.frame_referenced(node));
 
   _bodyRetLabel.push(++_lbl);
 
@@ -647,17 +714,14 @@ void til::postfix_writer::do_function_definition_node(til::function_definition_n
     _pf.GLOBAL(function->name(), _pf.FUNC());
   _pf.LABEL(function->name());
 
-  // compute stack size to be reserved for local variables
-  frame_size_calculator lsc(_compiler, _symtab, _functions);
-  node->accept(&lsc, lvl);
-  _pf.ENTER(lsc.localsize()); // total stack size reserved for local variables
+  _pf.ENTER(_frames.localsize(node)); // total stack size reserved for local variables
 
   _offset = 0; // prepare for local variable
 
   _inFunctionBody++;
-  os() << "        ;; before body " << std::endl;
+  comment("before body");
   node->block()->accept(this, lvl + 2);
-  os() << "        ;; after body " << std::endl;
+  comment("after body");
   _inFunctionBody--;
 
   _pf.LABEL(mklbl(_bodyRetLabel.top()));
@@ -665,41 +729,34 @@ void til::postfix_writer::do_function_definition_node(til::function_definition_n
   _pf.RET();
   _bodyRetLabel.pop();
 
-  _symtab.pop(); // scope of arguments
-
-  _pf.LABEL(mklbl(functionEndLabel));
-
   _functions.pop();
-
-  set_function_symbol(function); // advise that a function symbol has been defined
+  _referencedFrames.pop();
 }
 
-void til::postfix_writer::do_function_call_node(til::function_call_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  std::shared_ptr<til::symbol> function;
-
-  if (node->expression()) {
-    node->expression()->accept(this, lvl + 2);
-
-    function = function_symbol();
-    if (function)
-      reset_function_symbol();
-  }
-  else {
-    // @ recursive function call
-    function = _functions.top();
+void til::postfix_writer::emit_nested(int lvl) {
+  while (!_nested.empty()) {
+    auto [node, function] = _nested.front();
+    _nested.pop_front();
+    emit_function(node, function, lvl); // may find more nested functions
   }
+}
 
-  auto function_type = cdk::functional_type::cast(function->type());
+std::string til::postfix_writer::direct_label(std::shared_ptr<til::symbol> function) const {
+  if (function->global())
+    return function->name(); // globals are labels
+  auto literal = _literals.find(_callees.callee(function.get()));
+  return literal == _literals.end() ? "" : literal->second->name();
+}
 
+int til::postfix_writer::emit_arguments(til::function_call_node *const node, std::shared_ptr<cdk::functional_type> type,
+                                        int lvl) {
   int argsSize = 0;
   if (node->arguments()) {
-    os() << "        ;; before arguments " << std::endl;
+    comment("before arguments");
     for (int i = node->arguments()->size() - 1; i >= 0; i--) {
       auto argument = dynamic_cast<cdk::expression_node*>(node->arguments()->node(i));
 
-      if (function_type->input(i)->name() == cdk::TYPE_FUNCTIONAL) {
+      if (type->input(i)->name() == cdk::TYPE_FUNCTIONAL) {
         argument->accept(this, lvl + 2);
 
         auto argument_function = function_symbol();
@@ -708,20 +765,96 @@ void til::postfix_writer::do_function_call_node(til::function_call_node *const n
 
         if (argument_function->global())
           _pf.ADDR(argument_function->name());
-        else
+        else {
           _pf.LOCAL(argument_function->offset());
+          _pf.LDINT();
+        }
       }
       else {
         argument->accept(this, lvl + 2);
-        if (function_type->input(i)->name() == cdk::TYPE_DOUBLE && argument->is_typed(cdk::TYPE_INT))
+        if (type->input(i)->name() == cdk::TYPE_DOUBLE && argument->is_typed(cdk::TYPE_INT))
           _pf.I2D();
       }
 
-      argsSize += function_type->input(i)->size();
+      argsSize += type->input(i)->size();
     }
-    os() << "        ;; after arguments " << std::endl;
+    comment("after arguments");
+  }
+  return argsSize;
+}
+
+bool til::postfix_writer::emit_tail_call(til::function_call_node *const node, int lvl) {
+  if (_inliner.inlined(node))
+    return false; // generated in place
+  if (_referencedFrames.top())
+    return false; // the callee may use this frame (objects or ?)
+
+  auto current = _functions.top();
+  std::shared_ptr<til::symbol> function;
+  if (!node->expression())
+    function = current; // @
+  else if (auto rvalue = dynamic_cast<cdk::rvalue_node*>(node->expression()))
+    if (auto variable = dynamic_cast<cdk::variable_node*>(rvalue->lvalue()))
+      function = _bindings.symbol(variable);
+  if (!function || function->qualifier() == tEXTERNAL)
+    return false;
+
+  std::string label = direct_label(function);
+  if (label.empty())
+    return false;
+
+  // the callee must use the caller's argument area and return its value in the same way
+  auto type = cdk::functional_type::cast(function->type());
+  auto caller = cdk::functional_type::cast(current->type());
+  if (type->input_length() != caller->input_length() || type->output(0)->name() != caller->output(0)->name() ||
+      _checker.returns_double(type) != _checker.returns_double(caller))
+    return false;
+  for (size_t i = 0; i < type->input_length(); i++)
+    if (type->input(i)->size() != caller->input(i)->size())
+      return false;
+
+  // all arguments are computed before any slot is overwritten
+  emit_arguments(node, type, lvl);
+  int offset = 8; // remember to account for the return address
+  for (size_t i = 0; i < type->input_length(); i++) {
+    _pf.LOCAL(offset);
+    if (type->input(i)->name() == cdk::TYPE_DOUBLE)
+      _pf.STDOUBLE();
+    else
+      _pf.STINT();
+    offset += type->input(i)->size();
+  }
+
+  _pf.LEAVE(); // the callee's frame takes the place of this one
+  _pf.JMP(label);
+  stats::add("tail calls");
+  return true;
+}
+
+void til::postfix_writer::do_function_call_node(til::function_call_node *const node, int lvl) {
+  if (auto callee = _inliner.inlined(node)) {
+    emit_inlined(node, callee, lvl);
+    return;
+  }
+
+  std::shared_ptr<til::symbol> function;
+
+  if (node->expression()) {
+    node->expression()->accept(this, lvl + 2);
+
+    function = function_symbol();
+    if (function)
+      reset_function_symbol();
+  }
+  else {
+    // @ recursive function call
+    function = _functions.top();
   }
 
+  auto function_type = cdk::functional_type::cast(function->type());
+
+  int argsSize = emit_arguments(node, function_type, lvl);
+
   if (function->qualifier() == tEXTERNAL) {
     _pf.CALL(function->name());
 
@@ -736,39 +869,94 @@ void til::postfix_writer::do_function_call_node(til::function_call_node *const n
     }
   }
   else {
-    if (function->global()) {
-      _pf.ADDR(function->name());
+    // globals are labels; some locals always hold the same function
+    std::string label = direct_label(function);
+    if (!label.empty()) {
+      _pf.CALL(label);
+      stats::add("devirtualized calls");
     }
     else {
       _pf.LOCAL(function->offset());
       _pf.LDINT();
+      _pf.BRANCH();
     }
 
-    _pf.BRANCH();  
-
     if (argsSize)
       _pf.TRASH(argsSize);
 
-    if (node->is_typed(cdk::TYPE_INT)) {
-      _pf.LDFVAL64();
-      _pf.D2I();
-    }
-    else if (node->is_typed(cdk::TYPE_DOUBLE)) {
-      _pf.LDFVAL64();
-    }
-    else if (!node->is_typed(cdk::TYPE_VOID)) {
-      _pf.LDFVAL32();
+    emit_result(node, function);
+  }
+}
+
+void til::postfix_writer::emit_result(til::function_call_node *const node, std::shared_ptr<til::symbol> function) {
+  if (node->is_typed(cdk::TYPE_INT) && _checker.returns_double(function->type())) {
+    _pf.LDFVAL64();
+    _pf.D2I();
+  }
+  else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    _pf.LDFVAL64();
+  }
+  else if (!node->is_typed(cdk::TYPE_VOID)) {
+    _pf.LDFVAL32();
+  }
+}
+
+void til::postfix_writer::emit_inlined(til::function_call_node *const node, til::function_definition_node *const callee,
+                                       int lvl) {
+  // the callee is called through a variable: its type is the one the call (and returns) use
+  auto variable = dynamic_cast<cdk::variable_node*>(dynamic_cast<cdk::rvalue_node*>(node->expression())->lvalue());
+  auto function = _bindings.symbol(variable);
+  comment("inlined call");
+
+  emit_arguments(node, cdk::functional_type::cast(function->type()), lvl);
+
+  int offset = _offset; // the arguments and locals are released after the body
+  if (callee->arguments()) {
+    for (size_t i = 0; i < callee->arguments()->size(); i++) {
+      auto argument = static_cast<til::variable_declaration_node*>(callee->arguments()->node(i));
+      _offset -= argument->type()->size();
+      argument->symbol()->set_offset(_offset);
+      _pf.LOCAL(_offset);
+      if (argument->is_typed(cdk::TYPE_DOUBLE))
+        _pf.STDOUBLE();
+      else
+        _pf.STINT();
     }
   }
+
+  // returns leave the value where a call would and jump to the end of the body
+  _functions.push(function);
+  _bodyRetLabel.push(++_lbl);
+  std::vector<int> loopTest, loopEnd;
+  std::swap(loopTest, _loopTest);
+  std::swap(loopEnd, _loopEnd);
+
+  _inInlinedBody++;
+  callee->block()->accept(this, lvl + 2);
+  _inInlinedBody--;
+
+  std::swap(loopTest, _loopTest);
+  std::swap(loopEnd, _loopEnd);
+  _pf.LABEL(mklbl(_bodyRetLabel.top()));
+  _bodyRetLabel.pop();
+  _functions.pop();
+  _offset = offset;
+
+  emit_result(node, function);
+  comment("end of inlined call");
+  stats::add("inlined calls");
 }
 
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_return_node(til::return_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   auto function_type = cdk::functional_type::cast(_functions.top()->type());
 
+  // a call in tail position reuses this frame (not the frame of the function an inlined body is in)
+  if (auto call = dynamic_cast<til::function_call_node*>(node->retval()))
+    if (!_inInlinedBody && emit_tail_call(call, lvl))
+      return;
+
   // should not reach here without returning a value (if not void)
   if (function_type->output(0)->name() != cdk::TYPE_VOID) {
     if (function_type->output(0)->name() == cdk::TYPE_FUNCTIONAL) {
@@ -792,8 +980,13 @@ void til::postfix_writer::do_return_node(til::return_node *const node, int lvl)
       node->retval()->accept(this, lvl);
 
       if (function_type->output(0)->name() == cdk::TYPE_INT) {
-        _pf.I2D();
-        _pf.STFVAL64();
+        if (_checker.returns_double(function_type)) {
+          _pf.I2D();
+          _pf.STFVAL64();
+        }
+        else {
+          _pf.STFVAL32();
+        }
       }
       else if (function_type->output(0)->name() == cdk::TYPE_DOUBLE) {
         if (node->retval()->is_typed(cdk::TYPE_INT))
@@ -818,8 +1011,6 @@ void til::postfix_writer::do_return_node(til::return_node *const node, int lvl)
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   const std::string &id = node->identifier();
 
   int offset, typesize = node->type()->size(); // in bytes
@@ -835,11 +1026,8 @@ void til::postfix_writer::do_variable_declaration_node(til::variable_declaration
     offset = 0; // global variable
   }
 
-  auto symbol = new_symbol();
-  if (symbol) {
-    symbol->set_offset(offset);
-    reset_new_symbol();
-  }
+  auto symbol = node->symbol();
+  symbol->set_offset(offset);
 
   if (_inFunctionArgs) {
     // if we are dealing with function arguments, then no action is needed
@@ -921,9 +1109,11 @@ void til::postfix_writer::do_variable_declaration_node(til::variable_declaration
           _pf.LABEL(id);
 
           if (node->initializer()->is_typed(cdk::TYPE_INT)) {
-            cdk::integer_node *dclini = dynamic_cast<cdk::integer_node*>(node->initializer());
-            cdk::double_node ddi(dclini->lineno(), dclini->value());
-            ddi.accept(this, lvl);
+            int value;
+            if (_folder.integer(node->initializer(), value))
+              _pf.SDOUBLE(value);
+            else
+              std::cerr << node->lineno() << ": '" << id << "' has non-constant initializer" << std::endl;
           }
           else if (node->initializer()->is_typed(cdk::TYPE_DOUBLE)) {
             node->initializer()->accept(this, lvl);
@@ -971,7 +1161,6 @@ void til::postfix_writer::do_variable_declaration_node(til::variable_declaration
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_nullptr_node(til::nullptr_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   if (_inFunctionBody)
     _pf.INT(0);
   else
@@ -979,29 +1168,23 @@ void til::postfix_writer::do_nullptr_node(til::nullptr_node *const node, int lvl
 }
 
 void til::postfix_writer::do_index_node(til::index_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   node->base()->accept(this, lvl + 2);
-  node->index()->accept(this, lvl + 2);
-  _pf.INT(node->type()->size());
-  _pf.MUL();
+  int index;
+  if (_folder.integer(node->index(), index) && index == 0)
+    return; // the base address
+  emit_scaled(node->index(), node->type()->size(), lvl + 2);
   _pf.ADD();
 }
 
 void til::postfix_writer::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   auto alloc_type = cdk::reference_type::cast(node->type());
 
-  node->argument()->accept(this, lvl + 2);
-  _pf.INT(alloc_type->referenced()->size());
-  _pf.MUL();
+  emit_scaled(node->argument(), alloc_type->referenced()->size(), lvl + 2);
   _pf.ALLOC(); // allocate
   _pf.SP(); // put base pointer in stack
 }
 
 void til::postfix_writer::do_address_of_node(til::address_of_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   // since the argument is an lvalue, it is already an address
   node->lvalue()->accept(this, lvl + 2);
 }
@@ -1009,6 +1192,5 @@ void til::postfix_writer::do_address_of_node(til::address_of_node *const node, i
 //---------------------------------------------------------------------------
 
 void til::postfix_writer::do_sizeof_node(til::sizeof_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   _pf.INT(node->expression()->type()->size());
 }
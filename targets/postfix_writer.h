@@ -2,11 +2,24 @@
 #define __TIL_TARGETS_POSTFIX_WRITER_H__
 
 #include "targets/basic_ast_visitor.h"
-
+#include "targets/bindings.h"
+#include "targets/constant_folder.h"
+#include "targets/callee_resolver.h"
+#include "targets/inliner.h"
+#include "targets/frame_size_calculator.h"
+#include "targets/type_checker.h"
+#include "targets/options.h"
+#include "targets/peephole_emitter.h"
+
+#include <deque>
+#include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include <stack>
-#include <sstream>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <cdk/emitters/basic_postfix_emitter.h>
 
 namespace til {
@@ -15,27 +28,42 @@ namespace til {
   //! Traverse syntax tree and generate the corresponding assembly code.
   //!
   class postfix_writer: public basic_ast_visitor {
-    cdk::symbol_table<til::symbol> &_symtab;
+    const til::bindings &_bindings;
+    const til::type_checker &_checker;
+    const til::frame_size_calculator &_frames;
+    const til::constant_folder &_folder;
+    const til::callee_resolver &_callees;
+    const til::inliner &_inliner;
 
     std::set<std::string> _functions_to_declare;
 
     // semantic analysis
     int _inFunctionArgs, _inFunctionBody;
+    int _inInlinedBody = 0;
     std::vector<int> _loopTest, _loopEnd; // for stop/next
     std::stack<std::shared_ptr<til::symbol>> _functions; // for keeping track of the current functions
+    std::stack<bool> _referencedFrames; // whether pointers into the current functions' frames may exist
     std::shared_ptr<til::symbol> _function_symbol; // last function symbol found in symbol table or defined
     int _offset; // current framepointer offset (0 means no vars defined)
 
     std::stack<int> _bodyRetLabel; // where to jump when a return occurs
+    std::deque<std::pair<til::function_definition_node*, std::shared_ptr<til::symbol>>> _nested; // bodies to emit after the current function
+    std::unordered_map<const til::function_definition_node*, std::shared_ptr<til::symbol>> _literals; // symbol of each function literal
 
     cdk::basic_postfix_emitter &_pf;
     int _lbl;
 
+    // constant pool: labels of the distinct literals (doubles by their bits)
+    std::map<std::string, int> _strings;
+    std::map<uint64_t, int> _doubles;
+
   public:
-    postfix_writer(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<til::symbol> &symtab,
-                   cdk::basic_postfix_emitter &pf) :
-        basic_ast_visitor(compiler), _symtab(symtab), _inFunctionArgs(0), _inFunctionBody(0), _offset(0), 
-        _pf(pf), _lbl(0) {
+    postfix_writer(std::shared_ptr<cdk::compiler> compiler, const til::bindings &bindings,
+                   const til::type_checker &checker, const til::frame_size_calculator &frames,
+                   const til::constant_folder &folder, const til::callee_resolver &callees,
+                   const til::inliner &inliner, cdk::basic_postfix_emitter &pf) :
+        basic_ast_visitor(compiler), _bindings(bindings), _checker(checker), _frames(frames), _folder(folder),
+        _callees(callees), _inliner(inliner), _inFunctionArgs(0), _inFunctionBody(0), _offset(0), _pf(pf), _lbl(0) {
     }
 
   public:
@@ -56,17 +84,79 @@ namespace til {
       _function_symbol = nullptr;
     }
 
+    /** Emit the constant pool: each distinct literal once, strings ending others inside them. */
+    void emit_constants();
+
   private:
+    /** Label of the literal in the constant pool (allocated on first use). */
+    int pooled(const std::string &text) {
+      auto [it, added] = _strings.try_emplace(text, 0);
+      if (added)
+        it->second = ++_lbl;
+      return it->second;
+    }
+    int pooled(double number) {
+      uint64_t bits;
+      std::memcpy(&bits, &number, sizeof(bits));
+      auto [it, added] = _doubles.try_emplace(bits, 0);
+      if (added)
+        it->second = ++_lbl;
+      return it->second;
+    }
+
     /** Method used to generate sequential labels. */
     inline std::string mklbl(int lbl) {
-      std::ostringstream oss;
-      if (lbl < 0)
-        oss << ".L" << -lbl;
+      char buffer[16] = { lbl < 0 ? '.' : '_', 'L' };
+      char *end = std::to_chars(buffer + 2, buffer + sizeof(buffer), lbl < 0 ? -lbl : lbl).ptr;
+      return std::string(buffer, end);
+    }
+
+    /** Annotate the assembly output (unless disabled with --no-asm-comments). */
+    void comment(const char *text) {
+      if (!options::get().asm_comments())
+        return;
+      if (auto peephole = dynamic_cast<peephole_emitter*>(&_pf))
+        peephole->comment(text); // keep it in order with the buffered instructions
       else
-        oss << "_L" << lbl;
-      return oss.str();
+        os() << "        ;; " << text << '\n';
     }
 
+    /** Generate the expression's replacement instead, if it was folded or simplified. */
+    bool emit_folded(cdk::expression_node *const node, int lvl);
+
+    /** Generate the function's code as a text-section unit of its own. */
+    void emit_function(til::function_definition_node *const node, std::shared_ptr<til::symbol> function, int lvl);
+
+    /** Generate the nested functions found so far (and the ones nested in them). */
+    void emit_nested(int lvl);
+
+    /** Push the arguments of a call (the last one first) and return their size. */
+    int emit_arguments(til::function_call_node *const node, std::shared_ptr<cdk::functional_type> type, int lvl);
+
+    /** Push the value returned by a call (the function's value register, as the call expects it). */
+    void emit_result(til::function_call_node *const node, std::shared_ptr<til::symbol> function);
+
+    /** Generate the callee's body in place of the call, with its arguments and locals in this frame. */
+    void emit_inlined(til::function_call_node *const node, til::function_definition_node *const callee, int lvl);
+
+    /** Replace the current function's activation with the call, if both frames are compatible. */
+    bool emit_tail_call(til::function_call_node *const node, int lvl);
+
+    /** Label of the function, if it is always the same one, or empty (externals are called by name). */
+    std::string direct_label(std::shared_ptr<til::symbol> function) const;
+
+    /** Push an integer offset scaled by an element size (computed here, if constant). */
+    void emit_scaled(cdk::expression_node *const offset, size_t size, int lvl);
+
+    /** Push the operands of a comparison, as doubles if either is; doubles are left compared with DCMP. */
+    void emit_comparison(cdk::binary_operation_node *const node, int lvl);
+
+    /** Jump to the label if the condition evaluates to "when" (without computing its value, if possible). */
+    void emit_branch(cdk::expression_node *const node, bool when, int lbl, int lvl);
+
+    /** Push the value (0 or 1) of a logical expression, computed by jumping code. */
+    void emit_boolean(cdk::expression_node *const node, int lvl);
+
   public:
   // do not edit these lines
 #define __IN_VISITOR_HEADER__
@@ -0,0 +1,126 @@
+#ifndef __TIL_TARGETS_REGISTER_TARGET_H__
+#define __TIL_TARGETS_REGISTER_TARGET_H__
+
+#include <cdk/targets/basic_target.h>
+#include <cdk/ast/basic_node.h>
+#include "targets/name_resolver.h"
+#include "targets/type_checker.h"
+#include "targets/constant_folder.h"
+#include "targets/ir_builder.h"
+#include "targets/linear_scan.h"
+#include "targets/options.h"
+#include "targets/stats.h"
+#include "targets/types.h"
+#include "targets/output_buffer.h"
+#include "targets/time_report.h"
+#include "arena.h"
+
+
+namespace til {
+
+  /**
+   * Code with register allocation: the typed tree is lowered to the
+   * register IR, integer registers get machine registers by linear scan,
+   * and the result is written as NASM assembly. The targets differ only
+   * in the size of pointers and in the writer (which also provides the
+   * allocator's registers).
+   */
+  template<typename Writer, int Pointer>
+  class register_target: public cdk::basic_target {
+  protected:
+    register_target(const char *name) :
+        cdk::basic_target(name) {
+    }
+
+  public:
+    bool evaluate(std::shared_ptr<cdk::compiler> compiler) {
+      // the driver has already scanned and parsed the input
+      time_report::since_start("phase", "startup and parsing");
+
+      til::bindings bindings;
+      {
+        time_report::scope phase("phase", "name resolution");
+        til::scope_table<til::symbol> symtab;
+        name_resolver resolver(compiler, symtab, bindings);
+        compiler->ast()->accept(&resolver, 0);
+        stats::add("bound identifiers", bindings.size());
+        stats::add("distinct identifiers", symtab.identifiers());
+        if (resolver.errors())
+          return false;
+      }
+
+      type_checker checker(compiler, bindings);
+      {
+        time_report::scope phase("phase", "type checking");
+        compiler->ast()->accept(&checker, 0);
+      }
+      stats::add("type checker visits", checker.visits());
+      if (checker.errors())
+        return false;
+
+      constant_folder folder(compiler, Pointer);
+      {
+        time_report::scope phase("phase", "constant folding");
+        compiler->ast()->accept(&folder, 0);
+      }
+
+      // lowering to the register IR
+      ir::module module;
+      {
+        time_report::scope phase("phase", "lowering");
+        ir_builder builder(compiler, bindings, checker, folder, module, Pointer);
+        compiler->ast()->accept(&builder, 0);
+        if (builder.errors())
+          return false;
+      }
+
+      // register allocation, function by function
+      {
+        time_report::scope phase("phase", "register allocation");
+        linear_scan allocator(Writer::registers());
+        for (auto &function : module.functions) {
+          time_report::scope timing("function", function.label);
+          allocator.allocate(function);
+          stats::add("virtual registers", function.registers.size());
+          stats::add("ir instructions", function.code.size());
+        }
+        stats::add("allocated registers", allocator.allocated());
+        stats::add("spilled registers", allocator.spilled());
+      }
+
+      // the assembly code is collected in memory and written at once
+      output_buffer buffer;
+      std::ostream &out = *compiler->ostream();
+      std::streambuf *file = out.rdbuf(&buffer);
+      {
+        time_report::scope phase("phase", "code generation");
+        Writer writer(out);
+        writer.write(module);
+      }
+      out.rdbuf(file);
+      {
+        time_report::scope phase("phase", "output");
+        buffer.write_to(out);
+      }
+      stats::add("assembly bytes", buffer.size());
+
+      if (options::get().stats()) {
+        stats::add("ast arena bytes used", arena::ast().used());
+        stats::add("ast arena bytes reserved", arena::ast().reserved());
+        stats::add("interned types", types::count());
+        stats::report(std::cerr);
+      }
+
+      if (options::get().time_report())
+        time_report::report(std::cerr);
+      if (!options::get().time_trace().empty() && !time_report::write_trace(options::get().time_trace()))
+        std::cerr << "cannot write time trace to '" << options::get().time_trace() << "'" << std::endl;
+
+      return true;
+    }
+
+  };
+
+} // til
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef __TIL_TARGETS_SCOPE_TABLE_H__
+#define __TIL_TARGETS_SCOPE_TABLE_H__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace til {
+
+  /**
+   * Scoped symbol table with a single flat hash for all scopes (a drop-in
+   * replacement for cdk::symbol_table).
+   *
+   * Identifiers are interned in an open-addressing hash: each name gets a
+   * dense integer id, and lookups by id never hash strings. Bindings are
+   * records in one vector, indexed by position; each record remembers the
+   * binding it shadows, so the vector is also the undo log used to pop a
+   * scope. Lookup is one probe plus one array access, whatever the depth
+   * of nesting or the number of symbols.
+   */
+  template<typename Symbol>
+  class scope_table {
+  public:
+    typedef uint32_t id_type;
+    static constexpr id_type none = UINT32_MAX;
+
+  private:
+    struct slot {
+      size_t hash;
+      id_type id; // none means empty
+    };
+
+    struct binding {
+      id_type id;
+      uint32_t shadowed; // previous binding for the same id (none if none)
+      uint32_t depth;    // scope where the binding was made
+    };
+
+    std::vector<slot> _slots;          // open addressing, linear probing
+    std::vector<std::string> _names;   // identifier for each id
+    std::vector<uint32_t> _innermost;  // innermost binding for each id
+
+    std::vector<binding> _bindings;    // undo log: one record per insertion
+    std::vector<std::shared_ptr<Symbol>> _symbols; // parallel to _bindings
+    std::vector<uint32_t> _scopes;     // first binding of each open scope
+
+  public:
+    scope_table() : _slots(64, slot{ 0, none }) {
+    }
+
+  public:
+    /** Open a new (inner) scope. */
+    void push() {
+      _scopes.push_back(_bindings.size());
+    }
+
+    /** Close the innermost scope, restoring the bindings it shadowed. */
+    void pop() {
+      uint32_t first = _scopes.back();
+      _scopes.pop_back();
+      while (_bindings.size() > first) {
+        const binding &b = _bindings.back();
+        _innermost[b.id] = b.shadowed;
+        _bindings.pop_back();
+        _symbols.pop_back();
+      }
+    }
+
+    /** Nesting depth of the innermost scope (0 is the global scope). */
+    uint32_t depth() const {
+      return _scopes.size();
+    }
+
+  public:
+    /** Id of an identifier, interning it if needed. */
+    id_type intern(const std::string &name) {
+      size_t hash = std::hash<std::string>()(name);
+      size_t mask = _slots.size() - 1;
+      size_t i = hash & mask;
+      for (; _slots[i].id != none; i = (i + 1) & mask)
+        if (_slots[i].hash == hash && _names[_slots[i].id] == name)
+          return _slots[i].id;
+
+      id_type id = _names.size();
+      _slots[i] = slot{ hash, id };
+      _names.push_back(name);
+      _innermost.push_back(none);
+      if (2 * _names.size() > _slots.size())
+        grow();
+      return id;
+    }
+
+    /** Id of an identifier, or none if it was never interned. */
+    id_type lookup(const std::string &name) const {
+      size_t hash = std::hash<std::string>()(name);
+      size_t mask = _slots.size() - 1;
+      for (size_t i = hash & mask; _slots[i].id != none; i = (i + 1) & mask)
+        if (_slots[i].hash == hash && _names[_slots[i].id] == name)
+          return _slots[i].id;
+      return none;
+    }
+
+    const std::string &name(id_type id) const {
+      return _names[id];
+    }
+
+    /** Number of distinct identifiers interned so far. */
+    size_t identifiers() const {
+      return _names.size();
+    }
+
+  public:
+    /** Bind a symbol in the innermost scope: fails if already bound there. */
+    bool insert(id_type id, std::shared_ptr<Symbol> symbol) {
+      if (find_local_binding(id) != none)
+        return false;
+      _bindings.push_back(binding{ id, _innermost[id], depth() });
+      _symbols.push_back(symbol);
+      _innermost[id] = _bindings.size() - 1;
+      return true;
+    }
+
+    /** Rebind the innermost binding of an identifier. */
+    bool replace(id_type id, std::shared_ptr<Symbol> symbol) {
+      if (id == none || _innermost[id] == none)
+        return false;
+      _symbols[_innermost[id]] = symbol;
+      return true;
+    }
+
+    std::shared_ptr<Symbol> find(id_type id) const {
+      if (id == none || _innermost[id] == none)
+        return nullptr;
+      return _symbols[_innermost[id]];
+    }
+
+    std::shared_ptr<Symbol> find_local(id_type id) const {
+      uint32_t b = find_local_binding(id);
+      return b == none ? nullptr : _symbols[b];
+    }
+
+  public:
+    // string interface, as in cdk::symbol_table
+    bool insert(const std::string &name, std::shared_ptr<Symbol> symbol) {
+      return insert(intern(name), symbol);
+    }
+    bool replace(const std::string &name, std::shared_ptr<Symbol> symbol) {
+      return replace(lookup(name), symbol);
+    }
+    std::shared_ptr<Symbol> find(const std::string &name) const {
+      return find(lookup(name));
+    }
+    std::shared_ptr<Symbol> find_local(const std::string &name) const {
+      return find_local(lookup(name));
+    }
+
+  private:
+    uint32_t find_local_binding(id_type id) const {
+      if (id == none)
+        return none;
+      uint32_t b = _innermost[id];
+      return (b != none && _bindings[b].depth == depth()) ? b : none;
+    }
+
+    void grow() {
+      std::vector<slot> slots(2 * _slots.size(), slot{ 0, none });
+      size_t mask = slots.size() - 1;
+      for (const slot &s : _slots) {
+        if (s.id == none)
+          continue;
+        size_t i = s.hash & mask;
+        while (slots[i].id != none)
+          i = (i + 1) & mask;
+        slots[i] = s;
+      }
+      _slots.swap(slots);
+    }
+
+  };
+
+} // til
+
+#endif
@@ -0,0 +1,21 @@
+#include <algorithm>
+#include <map>
+#include <iomanip>
+#include "targets/stats.h"
+
+static std::map<std::string, size_t> &counters() {
+  static std::map<std::string, size_t> counters;
+  return counters;
+}
+
+void til::stats::add(const std::string &counter, size_t amount) {
+  counters()[counter] += amount;
+}
+
+void til::stats::report(std::ostream &os) {
+  size_t width = 0; // the values line up after the longest name
+  for (auto &counter : counters())
+    width = std::max(width, counter.first.size());
+  for (auto &counter : counters())
+    os << ";; " << std::left << std::setw(width) << counter.first << "  " << counter.second << std::endl;
+}
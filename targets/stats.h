@@ -0,0 +1,21 @@
+#ifndef __TIL_TARGETS_STATS_H__
+#define __TIL_TARGETS_STATS_H__
+
+#include <string>
+#include <iostream>
+
+namespace til {
+
+  /**
+   * Named counters collected during a compilation and printed when
+   * the --stats option is active (see til::options).
+   */
+  class stats {
+  public:
+    static void add(const std::string &counter, size_t amount = 1);
+    static void report(std::ostream &os);
+  };
+
+} // til
+
+#endif
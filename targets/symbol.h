@@ -12,6 +12,7 @@ namespace til {
     std::shared_ptr<cdk::basic_type> _type;
     int _qualifier; // qualifiers: public, forward, external, "private" (i.e., none)
     int _offset = 0; // 0 (zero) means global variable/function
+    bool _addressed = false; // its address is taken (with ?)
 
   public:
     symbol(std::shared_ptr<cdk::basic_type> type, const std::string &name, int qualifier) :
@@ -52,6 +53,12 @@ namespace til {
     bool global() const {
       return _offset == 0;
     }
+    bool addressed() const {
+      return _addressed;
+    }
+    void set_addressed() {
+      _addressed = true;
+    }
   };
 
   inline auto make_symbol(std::shared_ptr<cdk::basic_type> type, const std::string &name, int qualifier) {
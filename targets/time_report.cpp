@@ -0,0 +1,137 @@
+#include <ctime>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <sys/resource.h>
+#include "targets/time_report.h"
+#include "targets/options.h"
+
+namespace {
+
+  struct event {
+    const char *category;
+    std::string name;
+    double wall_begin, wall_end; // microseconds
+    double cpu_begin, cpu_end;   // microseconds
+    long peak_rss;               // kilobytes
+  };
+
+  double clock_us(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+  }
+
+  double wall_us() {
+    return clock_us(CLOCK_MONOTONIC);
+  }
+
+  double cpu_us() {
+    return clock_us(CLOCK_PROCESS_CPUTIME_ID);
+  }
+
+  long peak_rss_kb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+  std::vector<event> &events() {
+    static std::vector<event> events;
+    return events;
+  }
+
+  // taken during static initialization: close enough to program start
+  const double start_wall = wall_us();
+  const double start_cpu = cpu_us();
+
+  std::string json_escape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+
+} // anonymous
+
+bool til::time_report::enabled() {
+  return options::get().time_report() || !options::get().time_trace().empty();
+}
+
+til::time_report::scope::scope(const char *category, const std::string &name) : _event(-1) {
+  if (enabled())
+    start(category, name);
+}
+
+void til::time_report::scope::start(const char *category, const std::string &name) {
+  _event = events().size();
+  events().push_back(event{ category, name, wall_us(), 0, cpu_us(), 0, 0 });
+}
+
+til::time_report::scope::~scope() {
+  if (_event < 0)
+    return;
+  event &e = events()[_event];
+  e.wall_end = wall_us();
+  e.cpu_end = cpu_us();
+  e.peak_rss = peak_rss_kb();
+}
+
+void til::time_report::since_start(const char *category, const std::string &name) {
+  if (!enabled())
+    return;
+  events().push_back(event{ category, name, start_wall, wall_us(), start_cpu, cpu_us(), peak_rss_kb() });
+}
+
+void til::time_report::report(std::ostream &os) {
+  auto line = [&os](const event &e) {
+    os << ";; " << std::left << std::setw(32) << e.name << std::right << std::fixed << std::setprecision(3)
+       << std::setw(10) << (e.wall_end - e.wall_begin) / 1e3 << std::setw(10) << (e.cpu_end - e.cpu_begin) / 1e3
+       << std::setw(12) << e.peak_rss << std::endl;
+  };
+  auto header = [&os](const char *title) {
+    os << ";; " << std::left << std::setw(32) << title << std::right << std::setw(10) << "wall ms" << std::setw(10)
+       << "cpu ms" << std::setw(12) << "peak KB" << std::endl;
+  };
+
+  header("phase");
+  for (auto &e : events())
+    if (std::string(e.category) == "phase")
+      line(e);
+
+  // slowest first; times of nested functions are included in their parents'
+  std::vector<const event*> functions;
+  for (auto &e : events())
+    if (std::string(e.category) == "function")
+      functions.push_back(&e);
+  std::stable_sort(functions.begin(), functions.end(), [](const event *a, const event *b) {
+    return a->wall_end - a->wall_begin > b->wall_end - b->wall_begin;
+  });
+
+  if (!functions.empty())
+    header("function (code generation)");
+  for (auto e : functions)
+    line(*e);
+  os.unsetf(std::ios::floatfield);
+}
+
+bool til::time_report::write_trace(const std::string &filename) {
+  std::ofstream trace(filename);
+  if (!trace)
+    return false;
+
+  trace << "{\"traceEvents\":[";
+  for (size_t i = 0; i < events().size(); i++) {
+    const event &e = events()[i];
+    trace << (i ? ",\n" : "\n") << "{\"name\":\"" << json_escape(e.name) << "\",\"cat\":\"" << e.category
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << std::fixed << std::setprecision(3) << e.wall_begin - start_wall
+          << ",\"dur\":" << e.wall_end - e.wall_begin << ",\"args\":{\"cpu_us\":" << e.cpu_end - e.cpu_begin
+          << ",\"peak_rss_kb\":" << e.peak_rss << "}}";
+  }
+  trace << "\n]}\n";
+  return bool(trace);
+}
@@ -0,0 +1,50 @@
+#ifndef __TIL_TARGETS_TIME_REPORT_H__
+#define __TIL_TARGETS_TIME_REPORT_H__
+
+#include <string>
+#include <iostream>
+#include <type_traits>
+
+namespace til {
+
+  /**
+   * Wall time, CPU time and peak memory of each compilation phase and of
+   * the code generation of each function. Printed when the --time-report
+   * option is active; --time-trace=FILE also saves the events as a Chrome
+   * trace (chrome://tracing, Perfetto).
+   */
+  class time_report {
+  public:
+    /** Record the lifetime of this object as an event (if enabled). */
+    class scope {
+      long _event;
+
+      void start(const char *category, const std::string &name);
+
+    public:
+      scope(const char *category, const std::string &name);
+
+      /** The name is built (by calling name()) only if events are being recorded. */
+      template<typename F, typename = std::enable_if_t<std::is_invocable_r_v<std::string, F&>>>
+      scope(const char *category, F &&name) : _event(-1) {
+        if (enabled())
+          start(category, name());
+      }
+
+      ~scope();
+    };
+
+  public:
+    /** Whether events are being recorded. */
+    static bool enabled();
+
+    /** Record an event from program start until now (e.g., parsing). */
+    static void since_start(const char *category, const std::string &name);
+
+    static void report(std::ostream &os);
+    static bool write_trace(const std::string &filename);
+  };
+
+} // til
+
+#endif
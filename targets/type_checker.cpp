@@ -1,13 +1,64 @@
 #include <string>
 #include "targets/type_checker.h"
 #include ".auto/all_nodes.h"  // automatically generated
-#include <cdk/types/primitive_type.h>
+#include "targets/types.h"
 
 #include "til_parser.tab.h"
 
 #define ASSERT_UNSPEC { if (node->type() != nullptr && !node->is_typed(cdk::TYPE_UNSPEC)) return; }
 
+void til::type_checker::check_compatible_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2,
+                                               void (type_checker::*match)(std::shared_ptr<cdk::basic_type>, std::shared_ptr<cdk::basic_type>)) {
+  if (type1.get() == type2.get())
+    return; // types are unique: they are structurally equal
+
+  auto key = std::make_pair(type1.get(), type2.get());
+  auto memo = _compatible.find(key);
+  if (memo == _compatible.end()) {
+    try {
+      (this->*match)(type1, type2);
+      memo = _compatible.emplace(key, "").first;
+    }
+    catch (const std::string &problem) {
+      memo = _compatible.emplace(key, problem).first;
+    }
+  }
+
+  if (!memo->second.empty())
+    throw memo->second;
+}
+
+bool til::type_checker::returns_double(std::shared_ptr<cdk::basic_type> type) const {
+  auto output = cdk::functional_type::cast(type)->output(0);
+  if (output->name() == cdk::TYPE_DOUBLE)
+    return true;
+  return output->name() == cdk::TYPE_INT && _double_returns.count(return_class(type.get()));
+}
+
+const cdk::basic_type *til::type_checker::return_class(const cdk::basic_type *type) const {
+  for (auto link = _return_links.find(type); link != _return_links.end(); link = _return_links.find(type))
+    type = link->second;
+  return type;
+}
+
+void til::type_checker::join_returns(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2) {
+  auto class1 = return_class(type1.get()), class2 = return_class(type2.get());
+  if (class1 == class2)
+    return;
+  _return_links[class2] = class1;
+  if (_double_returns.count(class2))
+    _double_returns.insert(class1);
+}
+
 void til::type_checker::check_functional_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2) {
+  check_compatible_types(type1, type2, &type_checker::match_functional_types);
+}
+
+void til::type_checker::check_reference_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2) {
+  check_compatible_types(type1, type2, &type_checker::match_reference_types);
+}
+
+void til::type_checker::match_functional_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2) {
   auto functional_type1 = cdk::functional_type::cast(type1);
   auto functional_type2 = cdk::functional_type::cast(type2);
 
@@ -15,6 +66,9 @@ void til::type_checker::check_functional_types(std::shared_ptr<cdk::basic_type>
   if (functional_type1->output(0)->name() == cdk::TYPE_DOUBLE) {
     if (!(functional_type2->output(0)->name() == cdk::TYPE_DOUBLE || functional_type2->output(0)->name() == cdk::TYPE_INT))
       throw std::string("wrong types for function outputs");
+
+    if (functional_type2->output(0)->name() == cdk::TYPE_INT)
+      _double_returns.insert(return_class(type2.get())); // int results are read as doubles
   }
   else if (functional_type1->output(0)->name() == cdk::TYPE_FUNCTIONAL) {
     if (!(functional_type2->output(0)->name() == cdk::TYPE_FUNCTIONAL))
@@ -22,9 +76,12 @@ void til::type_checker::check_functional_types(std::shared_ptr<cdk::basic_type>
 
     check_functional_types(functional_type1->output(0), functional_type2->output(0));
   }
-  else if (functional_type1->output(0) != functional_type2->output(0)) {
+  else if (functional_type1->output(0).get() != functional_type2->output(0).get()) {
     throw std::string("wrong types for function outputs");
   }
+  else if (functional_type1->output(0)->name() == cdk::TYPE_INT) {
+    join_returns(type1, type2); // values of one type are called as the other
+  }
 
   // arguments/inputs
   if (functional_type1->input_length() == functional_type2->input_length()) {
@@ -46,7 +103,7 @@ void til::type_checker::check_functional_types(std::shared_ptr<cdk::basic_type>
 
         check_functional_types(functional_type1->input(i), functional_type2->input(i));
       }
-      else if (functional_type1->input(i) != functional_type2->input(i)) {
+      else if (functional_type1->input(i).get() != functional_type2->input(i).get()) {
         throw std::string("wrong types for function inputs");
       }
 
@@ -57,7 +114,7 @@ void til::type_checker::check_functional_types(std::shared_ptr<cdk::basic_type>
   }
 }
 
-void til::type_checker::check_reference_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2) {
+void til::type_checker::match_reference_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2) {
   auto reference_type1 = cdk::reference_type::cast(type1);
   auto reference_type2 = cdk::reference_type::cast(type2);
 
@@ -73,40 +130,54 @@ void til::type_checker::check_reference_types(std::shared_ptr<cdk::basic_type> t
 
     check_functional_types(reference_type1->referenced(), reference_type2->referenced());
   }
-  else if (reference_type1->referenced() != reference_type2->referenced())
+  else if (reference_type1->referenced().get() != reference_type2->referenced().get())
     throw std::string("wrong types for reference");
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_sequence_node(cdk::sequence_node *const node, int lvl) {
-  // EMPTY
+  _visits++;
+  for (size_t i = 0; i < node->size(); i++) {
+    try {
+      node->node(i)->accept(this, lvl);
+    }
+    catch (const std::string &problem) {
+      std::cerr << node->node(i)->lineno() << ": " << problem << std::endl;
+      _errors++;
+    }
+  }
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_nil_node(cdk::nil_node *const node, int lvl) {
+  _visits++;
   // EMPTY
 }
 void til::type_checker::do_data_node(cdk::data_node *const node, int lvl) {
+  _visits++;
   // EMPTY
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_integer_node(cdk::integer_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 
 void til::type_checker::do_double_node(cdk::double_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
-  node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+  node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
 }
 
 void til::type_checker::do_string_node(cdk::string_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
+  node->type(til::types::primitive(4, cdk::TYPE_STRING));
 }
 
 //---------------------------------------------------------------------------
@@ -114,27 +185,29 @@ void til::type_checker::do_string_node(cdk::string_node *const node, int lvl) {
 void til::type_checker::do_UnaryIntDoubleExpression(cdk::unary_operation_node *const node, int lvl) {
   node->argument()->accept(this, lvl + 2);
   if (node->argument()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->argument()->is_typed(cdk::TYPE_DOUBLE)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->argument()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->argument()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->argument()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else {
     throw std::string("wrong type in unary expression");
   }
 
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 
 void til::type_checker::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  _visits++;
   do_UnaryIntDoubleExpression(node, lvl);
 }
 
 void til::type_checker::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  _visits++;
   do_UnaryIntDoubleExpression(node, lvl);
 }
 
@@ -146,20 +219,20 @@ void til::type_checker::do_IntExpression(cdk::binary_operation_node *const node,
   node->right()->accept(this, lvl + 2);
 
   if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->left()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->right()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->left()->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->right()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->right()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->right()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->left()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));;
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->left()->type(til::types::primitive(4, cdk::TYPE_INT));;
   }
   else {
     throw std::string("wrong types in binary expression");
@@ -172,37 +245,37 @@ void til::type_checker::do_IntDoubleExpression(cdk::binary_operation_node *const
   node->right()->accept(this, lvl + 2);
 
   if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_DOUBLE)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_DOUBLE)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->left()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->right()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->left()->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->right()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->right()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->right()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->left()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));;
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->left()->type(til::types::primitive(4, cdk::TYPE_INT));;
   }
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
-    node->right()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
+    node->right()->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_DOUBLE)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
-    node->left()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
+    node->left()->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else {
     throw std::string("wrong types in binary expression");
@@ -215,20 +288,20 @@ void til::type_checker::do_IntDoublePointerExpression(cdk::binary_operation_node
   node->right()->accept(this, lvl + 2);
 
   if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_DOUBLE)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_DOUBLE)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (sub && node->left()->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_POINTER)) {
     check_reference_types(node->left()->type(), node->right()->type());
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_INT)) {
     node->type(node->left()->type());
@@ -237,25 +310,25 @@ void til::type_checker::do_IntDoublePointerExpression(cdk::binary_operation_node
     node->type(node->right()->type());
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->left()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->right()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->left()->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->right()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->right()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->right()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->left()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));;
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->left()->type(til::types::primitive(4, cdk::TYPE_INT));;
   }
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
-    node->right()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
+    node->right()->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else if (node->left()->is_typed(cdk::TYPE_UNSPEC) && node->right()->is_typed(cdk::TYPE_DOUBLE)) {
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
-    node->left()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
+    node->left()->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
   }
   else {
     throw std::string("wrong types in binary expression");
@@ -263,57 +336,69 @@ void til::type_checker::do_IntDoublePointerExpression(cdk::binary_operation_node
 }
 
 void til::type_checker::do_add_node(cdk::add_node *const node, int lvl) {
+  _visits++;
   do_IntDoublePointerExpression(node, lvl);
 }
 void til::type_checker::do_sub_node(cdk::sub_node *const node, int lvl) {
+  _visits++;
   do_IntDoublePointerExpression(node, lvl, true);
 }
 void til::type_checker::do_mul_node(cdk::mul_node *const node, int lvl) {
+  _visits++;
   do_IntDoubleExpression(node, lvl);
 }
 void til::type_checker::do_div_node(cdk::div_node *const node, int lvl) {
+  _visits++;
   do_IntDoubleExpression(node, lvl);
 }
 void til::type_checker::do_mod_node(cdk::mod_node *const node, int lvl) {
+  _visits++;
   do_IntExpression(node, lvl);
 }
 void til::type_checker::do_lt_node(cdk::lt_node *const node, int lvl) {
+  _visits++;
   do_IntDoubleExpression(node, lvl);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 void til::type_checker::do_le_node(cdk::le_node *const node, int lvl) {
+  _visits++;
   do_IntDoubleExpression(node, lvl);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 void til::type_checker::do_ge_node(cdk::ge_node *const node, int lvl) {
+  _visits++;
   do_IntDoubleExpression(node, lvl);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 void til::type_checker::do_gt_node(cdk::gt_node *const node, int lvl) {
+  _visits++;
   do_IntDoubleExpression(node, lvl);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 void til::type_checker::do_ne_node(cdk::ne_node *const node, int lvl) {
+  _visits++;
   do_IntDoublePointerExpression(node, lvl);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 void til::type_checker::do_eq_node(cdk::eq_node *const node, int lvl) {
+  _visits++;
   do_IntDoublePointerExpression(node, lvl);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_not_node(cdk::not_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   node->argument()->accept(this, lvl + 2);
 
   if (node->argument()->is_typed(cdk::TYPE_INT)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else if (node->argument()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-    node->argument()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(til::types::primitive(4, cdk::TYPE_INT));
+    node->argument()->type(til::types::primitive(4, cdk::TYPE_INT));
   }
   else {
     throw std::string("wrong type in unary expression");
@@ -321,41 +406,42 @@ void til::type_checker::do_not_node(cdk::not_node *const node, int lvl) {
 }
 
 void til::type_checker::do_and_node(cdk::and_node *const node, int lvl) {
+  _visits++;
   do_IntExpression(node, lvl);
 }
 void til::type_checker::do_or_node(cdk::or_node *const node, int lvl) {
+  _visits++;
   do_IntExpression(node, lvl);
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_variable_node(cdk::variable_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
-  const std::string &id = node->name();
-  auto symbol = _symtab.find(id);
-  if (!symbol)
-    throw std::string("undeclared variable '" + id + "'");
-  node->type(symbol->type());
+  node->type(_bindings.symbol(node)->type());
 }
 
 void til::type_checker::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   node->lvalue()->accept(this, lvl);
   node->type(node->lvalue()->type());
 }
 
 void til::type_checker::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   node->lvalue()->accept(this, lvl + 4);
   node->rvalue()->accept(this, lvl + 4);
 
   if (node->lvalue()->is_typed(cdk::TYPE_INT)) {
     if (node->rvalue()->is_typed(cdk::TYPE_INT)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+      node->type(til::types::primitive(4, cdk::TYPE_INT));
     }
     else if (node->rvalue()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-      node->rvalue()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+      node->type(til::types::primitive(4, cdk::TYPE_INT));
+      node->rvalue()->type(til::types::primitive(4, cdk::TYPE_INT));
     }
     else {
       throw std::string("wrong assignment to integer");
@@ -363,11 +449,11 @@ void til::type_checker::do_assignment_node(cdk::assignment_node *const node, int
   }
   else if (node->lvalue()->is_typed(cdk::TYPE_DOUBLE)) {
     if (node->rvalue()->is_typed(cdk::TYPE_DOUBLE) || node->rvalue()->is_typed(cdk::TYPE_INT)) {
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
     }
     else if (node->rvalue()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
-      node->rvalue()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
+      node->rvalue()->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
     }
     else {
       throw std::string("wrong assignment to real");
@@ -375,11 +461,11 @@ void til::type_checker::do_assignment_node(cdk::assignment_node *const node, int
   }
   else if (node->lvalue()->is_typed(cdk::TYPE_STRING)) {
     if (node->rvalue()->is_typed(cdk::TYPE_STRING)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
+      node->type(til::types::primitive(4, cdk::TYPE_STRING));
     }
     else if (node->rvalue()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
-      node->rvalue()->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
+      node->type(til::types::primitive(4, cdk::TYPE_STRING));
+      node->rvalue()->type(til::types::primitive(4, cdk::TYPE_STRING));
     }
     else {
       throw std::string("wrong assignment to string");
@@ -414,68 +500,103 @@ void til::type_checker::do_assignment_node(cdk::assignment_node *const node, int
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_block_node(til::block_node *const node, int lvl) {
-  // EMPTY
+  _visits++;
+  if (node->declarations())
+    node->declarations()->accept(this, lvl + 2);
+  if (node->instructions())
+    node->instructions()->accept(this, lvl + 2);
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_program_node(til::program_node *const node, int lvl) {
-  auto symbol = til::make_symbol(node->type(), "_main", tPUBLIC);
-  _symtab.insert("_main", symbol);
-  _parent->set_new_symbol(symbol); // advise parent that a symbol has been inserted
+  _visits++;
+  auto function = til::make_symbol(node->type(), "_main", tPUBLIC);
+
+  _functions.push(function);
+  node->block()->accept(this, lvl + 2);
+  _functions.pop();
 }
 
 void til::type_checker::do_evaluation_node(til::evaluation_node *const node, int lvl) {
+  _visits++;
   node->argument()->accept(this, lvl + 2);
 }
 
 void til::type_checker::do_print_node(til::print_node *const node, int lvl) {
-  // EMPTY
+  _visits++;
+  for (size_t ix = 0; ix < node->arguments()->size(); ix++) {
+    auto argument = dynamic_cast<cdk::expression_node*>(node->arguments()->node(ix));
+    argument->accept(this, lvl + 2);
+
+    if (argument->is_typed(cdk::TYPE_UNSPEC))
+      argument->type(til::types::primitive(4, cdk::TYPE_INT));
+    else if (!(argument->is_typed(cdk::TYPE_INT) || argument->is_typed(cdk::TYPE_DOUBLE) || argument->is_typed(cdk::TYPE_STRING)))
+      throw std::string("wrong type for print (integer, double or string expected).");
+  }
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_read_node(til::read_node *const node, int lvl) {
-  node->type(cdk::primitive_type::create(0, cdk::TYPE_UNSPEC));
+  _visits++;
+  node->type(til::types::primitive(0, cdk::TYPE_UNSPEC));
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_loop_node(til::loop_node *const node, int lvl) {
+  _visits++;
   node->condition()->accept(this, lvl + 4);
   if (!node->condition()->is_typed(cdk::TYPE_INT))
     throw std::string("expected integer condition");
+  node->block()->accept(this, lvl + 4);
 }
 
 void til::type_checker::do_stop_node(til::stop_node *const node, int lvl) {
+  _visits++;
   // EMPTY
 }
 
 void til::type_checker::do_next_node(til::next_node *const node, int lvl) {
+  _visits++;
   // EMPTY
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_if_node(til::if_node *const node, int lvl) {
+  _visits++;
   node->condition()->accept(this, lvl + 4);
   if (!node->condition()->is_typed(cdk::TYPE_INT))
     throw std::string("expected integer condition");
+  node->block()->accept(this, lvl + 4);
 }
 
 void til::type_checker::do_if_else_node(til::if_else_node *const node, int lvl) {
+  _visits++;
   node->condition()->accept(this, lvl + 4);
   if (!node->condition()->is_typed(cdk::TYPE_INT))
     throw std::string("expected integer condition");
+  node->thenblock()->accept(this, lvl + 4);
+  node->elseblock()->accept(this, lvl + 4);
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_function_definition_node(til::function_definition_node *const node, int lvl) {
-  // EMPTY
+  _visits++;
+  auto function = til::make_symbol(node->type(), "", tPRIVATE);
+
+  _functions.push(function);
+  if (node->arguments())
+    node->arguments()->accept(this, lvl + 4);
+  node->block()->accept(this, lvl + 2);
+  _functions.pop();
 }
 
 void til::type_checker::do_function_call_node(til::function_call_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   std::shared_ptr<cdk::functional_type> function_type;
 
@@ -513,7 +634,7 @@ void til::type_checker::do_function_call_node(til::function_call_node *const nod
 
           check_functional_types(function_type->input(i), argument->type());
         }
-        else if (function_type->input(i) != argument->type()) {
+        else if (function_type->input(i).get() != argument->type().get()) {
           throw std::string("wrong type for input");
         }
 
@@ -533,6 +654,7 @@ void til::type_checker::do_function_call_node(til::function_call_node *const nod
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_return_node(til::return_node *const node, int lvl) {
+  _visits++;
   auto function_type = cdk::functional_type::cast(_functions.top()->type());
 
   if (node->retval()) {
@@ -582,6 +704,7 @@ void til::type_checker::do_return_node(til::return_node *const node, int lvl) {
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_variable_declaration_node(til::variable_declaration_node *const node, int lvl) {
+  _visits++;
   if (node->type() && node->is_typed(cdk::TYPE_VOID))
     throw std::string("variable cannot be of type void.");
 
@@ -601,14 +724,14 @@ void til::type_checker::do_variable_declaration_node(til::variable_declaration_n
     }
     else if (node->is_typed(cdk::TYPE_INT)) {
       if (node->initializer()->is_typed(cdk::TYPE_UNSPEC))
-        node->initializer()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+        node->initializer()->type(til::types::primitive(4, cdk::TYPE_INT));
 
       if (!node->initializer()->is_typed(cdk::TYPE_INT))
         throw std::string("wrong type for initializer (integer expected).");
     }
     else if (node->is_typed(cdk::TYPE_DOUBLE)) {
       if (node->initializer()->is_typed(cdk::TYPE_UNSPEC))
-        node->initializer()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+        node->initializer()->type(til::types::primitive(8, cdk::TYPE_DOUBLE));
 
       if (!(node->initializer()->is_typed(cdk::TYPE_INT) || node->initializer()->is_typed(cdk::TYPE_DOUBLE)))
         throw std::string("wrong type for initializer (integer or double expected).");
@@ -639,55 +762,43 @@ void til::type_checker::do_variable_declaration_node(til::variable_declaration_n
     }
   }
 
-  const std::string &id = node->identifier();
-  auto symbol = til::make_symbol(node->type(), id, node->qualifier());
+  auto symbol = node->symbol();
+  symbol->set_type(node->type());
 
-  auto previous = _symtab.find_local(id);
+  auto previous = node->forward();
   if (previous) {
-    if (previous->qualifier() == tFORWARD) {
-      if (symbol->is_typed(cdk::TYPE_DOUBLE)) {
-        if (!(previous->is_typed(cdk::TYPE_DOUBLE) || previous->is_typed(cdk::TYPE_INT)))
-          throw std::string("wrong type for forward variable");
-      }
-      else if (symbol->is_typed(cdk::TYPE_POINTER)) {
-        if (!previous->is_typed(cdk::TYPE_POINTER))
-          throw std::string("wrong type for forward variable");
-
-        check_reference_types(symbol->type(), previous->type());
-      }
-      else if (symbol->is_typed(cdk::TYPE_FUNCTIONAL)) {
-        if (!previous->is_typed(cdk::TYPE_FUNCTIONAL))
-          throw std::string("wrong type for forward variable");
+    if (symbol->is_typed(cdk::TYPE_DOUBLE)) {
+      if (!(previous->is_typed(cdk::TYPE_DOUBLE) || previous->is_typed(cdk::TYPE_INT)))
+        throw std::string("wrong type for forward variable");
+    }
+    else if (symbol->is_typed(cdk::TYPE_POINTER)) {
+      if (!previous->is_typed(cdk::TYPE_POINTER))
+        throw std::string("wrong type for forward variable");
 
-        check_functional_types(symbol->type(), previous->type());
-      }
-      else if (symbol->type() != previous->type()) {
+      check_reference_types(symbol->type(), previous->type());
+    }
+    else if (symbol->is_typed(cdk::TYPE_FUNCTIONAL)) {
+      if (!previous->is_typed(cdk::TYPE_FUNCTIONAL))
         throw std::string("wrong type for forward variable");
-      }
-      
-      symbol->qualifier(tPUBLIC);
-      _symtab.replace(id, symbol);
-      _parent->set_new_symbol(symbol); // advise parent that a symbol has been inserted
+
+      check_functional_types(symbol->type(), previous->type());
     }
-    else {
-      throw std::string("variable '" + id + "' redeclared");
+    else if (symbol->type().get() != previous->type().get()) {
+      throw std::string("wrong type for forward variable");
     }
   }
-  else {
-    _symtab.insert(id, symbol);
-    _parent->set_new_symbol(symbol); // advise parent that a symbol has been inserted
-  }
-  
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_nullptr_node(til::nullptr_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
-  node->type(cdk::reference_type::create(4, cdk::primitive_type::create(0, cdk::TYPE_UNSPEC)));
+  node->type(til::types::reference(4, til::types::primitive(0, cdk::TYPE_UNSPEC)));
 }
 
 void til::type_checker::do_index_node(til::index_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   node->base()->accept(this, lvl + 2);
 
@@ -707,24 +818,27 @@ void til::type_checker::do_index_node(til::index_node *const node, int lvl) {
 }
 
 void til::type_checker::do_stack_alloc_node(til::stack_alloc_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   node->argument()->accept(this, lvl + 2);
   if (!node->argument()->is_typed(cdk::TYPE_INT))
     throw std::string("integer expression expected in allocation expression");
 
-  node->type(cdk::reference_type::create(4, cdk::primitive_type::create(0, cdk::TYPE_UNSPEC)));
+  node->type(til::types::reference(4, til::types::primitive(0, cdk::TYPE_UNSPEC)));
 }
 
 void til::type_checker::do_address_of_node(til::address_of_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   node->lvalue()->accept(this, lvl + 2);
-  node->type(cdk::reference_type::create(4, node->lvalue()->type()));
+  node->type(til::types::reference(4, node->lvalue()->type()));
 }
 
 //---------------------------------------------------------------------------
 
 void til::type_checker::do_sizeof_node(til::sizeof_node *const node, int lvl) {
+  _visits++;
   ASSERT_UNSPEC;
   node->expression()->accept(this, lvl + 2);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(til::types::primitive(4, cdk::TYPE_INT));
 }
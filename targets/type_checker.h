@@ -2,23 +2,38 @@
 #define __TIL_TARGETS_TYPE_CHECKER_H__
 
 #include "targets/basic_ast_visitor.h"
+#include "targets/bindings.h"
 
+#include <map>
 #include <stack>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace til {
 
   /**
-   * Print nodes as XML elements to the output stream.
+   * Type check the whole syntax tree in a single pass, annotating each
+   * expression with its type. Names must already have been resolved.
    */
   class type_checker: public basic_ast_visitor {
-    cdk::symbol_table<til::symbol> &_symtab;
+    const til::bindings &_bindings;
     std::stack<std::shared_ptr<til::symbol>> _functions;
-    basic_ast_visitor *_parent;
+
+    // memo of compatibility checks between (unique) types: empty if compatible,
+    // otherwise the problem found
+    std::map<std::pair<const cdk::basic_type*, const cdk::basic_type*>, std::string> _compatible;
+
+    // int-returning functional types whose values flow into each other share
+    // a return convention (union-find); a class is in _double_returns if
+    // any of its values may be called as a double-returning function
+    std::unordered_map<const cdk::basic_type*, const cdk::basic_type*> _return_links;
+    std::unordered_set<const cdk::basic_type*> _double_returns;
+
+    size_t _visits, _errors;
 
   public:
-    type_checker(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<til::symbol> &symtab, 
-                 std::stack<std::shared_ptr<til::symbol>> &functions, basic_ast_visitor *parent) :
-        basic_ast_visitor(compiler), _symtab(symtab), _functions(functions), _parent(parent) {
+    type_checker(std::shared_ptr<cdk::compiler> compiler, const til::bindings &bindings) :
+        basic_ast_visitor(compiler), _bindings(bindings), _visits(0), _errors(0) {
     }
 
   public:
@@ -26,7 +41,32 @@ namespace til {
       os().flush();
     }
 
+  public:
+    /** Number of nodes visited (for --stats). */
+    size_t visits() const {
+      return _visits;
+    }
+
+    /** Number of errors reported: code must not be generated if non-zero. */
+    size_t errors() const {
+      return _errors;
+    }
+
+    /**
+     * Whether functions of the given functional type return their value in
+     * the FPU (STFVAL64): those returning doubles, and those returning ints
+     * that may be called through double-returning functional values. Other
+     * results are returned in a register (STFVAL32).
+     */
+    bool returns_double(std::shared_ptr<cdk::basic_type> type) const;
+
   protected:
+    const cdk::basic_type *return_class(const cdk::basic_type *type) const;
+    void join_returns(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2);
+    void check_compatible_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2,
+                                void (type_checker::*match)(std::shared_ptr<cdk::basic_type>, std::shared_ptr<cdk::basic_type>));
+    void match_functional_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2);
+    void match_reference_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2);
     void check_functional_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2);
     void check_reference_types(std::shared_ptr<cdk::basic_type> type1, std::shared_ptr<cdk::basic_type> type2);
     void do_UnaryIntDoubleExpression(cdk::unary_operation_node *const node, int lvl);
@@ -48,21 +88,4 @@ namespace til {
 
 } // til
 
-//---------------------------------------------------------------------------
-//     HELPER MACRO FOR TYPE CHECKING
-//---------------------------------------------------------------------------
-
-#define CHECK_TYPES(compiler, symtab, functions, node) { \
-  try { \
-    til::type_checker checker(compiler, symtab, functions, this); \
-    (node)->accept(&checker, 0); \
-  } \
-  catch (const std::string &problem) { \
-    std::cerr << (node)->lineno() << ": " << problem << std::endl; \
-    return; \
-  } \
-}
-
-#define ASSERT_SAFE_EXPRESSIONS CHECK_TYPES(_compiler, _symtab, _functions, node)
-
 #endif
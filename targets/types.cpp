@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <unordered_map>
+#include "targets/types.h"
+
+namespace {
+
+  // a type is identified by its kind, its size and its (canonical) components
+  typedef std::vector<uintptr_t> type_key;
+
+  struct type_key_hash {
+    size_t operator()(const type_key &key) const {
+      size_t h = 0;
+      for (uintptr_t v : key)
+        h ^= std::hash<uintptr_t>()(v) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  std::unordered_map<type_key, std::shared_ptr<cdk::basic_type>, type_key_hash> &table() {
+    static std::unordered_map<type_key, std::shared_ptr<cdk::basic_type>, type_key_hash> table;
+    return table;
+  }
+
+  uintptr_t component(const std::shared_ptr<cdk::basic_type> &type) {
+    return reinterpret_cast<uintptr_t>(type.get());
+  }
+
+} // anonymous
+
+const std::shared_ptr<cdk::basic_type> &til::types::primitive(size_t size, cdk::typename_type name) {
+  auto &type = table()[type_key{ static_cast<uintptr_t>(name), size }];
+  if (!type)
+    type = cdk::primitive_type::create(size, name);
+  return type;
+}
+
+const std::shared_ptr<cdk::basic_type> &til::types::reference(size_t size, std::shared_ptr<cdk::basic_type> referenced) {
+  auto &type = table()[type_key{ cdk::TYPE_POINTER, size, component(referenced) }];
+  if (!type)
+    type = cdk::reference_type::create(size, referenced);
+  return type;
+}
+
+const std::shared_ptr<cdk::basic_type> &til::types::functional(std::shared_ptr<cdk::basic_type> output) {
+  return functional({}, output);
+}
+
+const std::shared_ptr<cdk::basic_type> &til::types::functional(const std::vector<std::shared_ptr<cdk::basic_type>> &inputs,
+                                                               std::shared_ptr<cdk::basic_type> output) {
+  type_key key{ cdk::TYPE_FUNCTIONAL, 4, component(output) };
+  for (auto &input : inputs)
+    key.push_back(component(input));
+
+  auto &type = table()[key];
+  if (!type)
+    type = cdk::functional_type::create(inputs, output);
+  return type;
+}
+
+size_t til::types::size(const std::shared_ptr<cdk::basic_type> &type, size_t pointer) {
+  switch (type->name()) {
+    case cdk::TYPE_POINTER:
+    case cdk::TYPE_STRING:
+    case cdk::TYPE_FUNCTIONAL:
+      return pointer;
+    default:
+      return type->size();
+  }
+}
+
+size_t til::types::count() {
+  return table().size();
+}
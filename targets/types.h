@@ -0,0 +1,36 @@
+#ifndef __TIL_TARGETS_TYPES_H__
+#define __TIL_TARGETS_TYPES_H__
+
+#include <memory>
+#include <vector>
+#include <cdk/types/types.h>
+
+namespace til {
+
+  /**
+   * Hash-consing factory for types: structurally equal types are always the
+   * same object, so types built here can be compared by pointer. All types
+   * in the syntax tree must be created through this class.
+   */
+  class types {
+  public:
+    static const std::shared_ptr<cdk::basic_type> &primitive(size_t size, cdk::typename_type name);
+    static const std::shared_ptr<cdk::basic_type> &reference(size_t size, std::shared_ptr<cdk::basic_type> referenced);
+    static const std::shared_ptr<cdk::basic_type> &functional(std::shared_ptr<cdk::basic_type> output);
+    static const std::shared_ptr<cdk::basic_type> &functional(const std::vector<std::shared_ptr<cdk::basic_type>> &inputs,
+                                                              std::shared_ptr<cdk::basic_type> output);
+
+    /**
+     * Size of a value of the type on a machine whose pointers (and strings
+     * and functions) have the given size: the sizes recorded in the types
+     * themselves assume 4-byte pointers.
+     */
+    static size_t size(const std::shared_ptr<cdk::basic_type> &type, size_t pointer);
+
+    /** Number of distinct types created so far (for --stats). */
+    static size_t count();
+  };
+
+} // til
+
+#endif
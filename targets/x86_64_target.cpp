@@ -0,0 +1,7 @@
+#include "targets/x86_64_target.h"
+
+/**
+ * Register-allocated x86-64.
+ * @var create and register an evaluator for X86_64 targets.
+ */
+til::x86_64_target til::x86_64_target::_self;
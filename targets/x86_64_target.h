@@ -0,0 +1,26 @@
+#ifndef __TIL_TARGETS_X86_64_TARGET_H__
+#define __TIL_TARGETS_X86_64_TARGET_H__
+
+#include "targets/register_target.h"
+#include "targets/x86_64_writer.h"
+
+namespace til {
+
+  /**
+   * x86-64 code: as for the "x86reg" target, with 8-byte pointers, the
+   * System V calling convention and SSE2 doubles. The result links with
+   * the 64-bit runtime library (see rts64/).
+   */
+  class x86_64_target: public register_target<x86_64_writer, 8> {
+    static x86_64_target _self;
+
+  private:
+    x86_64_target() :
+        register_target("x86_64") {
+    }
+
+  };
+
+} // til
+
+#endif
@@ -0,0 +1,629 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include "targets/x86_64_writer.h"
+
+//---------------------------------------------------------------------------
+
+namespace {
+
+  const char *signed_conditions[] = { "e", "ne", "l", "le", "g", "ge" };
+  const char *unsigned_conditions[] = { "e", "ne", "b", "be", "a", "ae" }; // after ucomisd
+
+  const char *integer_arguments[] = { "rdi", "rsi", "rdx", "rcx", "r8", "r9" };
+  const int double_arguments = 8; // xmm0-xmm7
+
+  std::string hex(uint64_t value) {
+    std::ostringstream out;
+    out << "0x" << std::hex << value;
+    return out.str();
+  }
+
+  uint64_t bits(double number) {
+    uint64_t value;
+    std::memcpy(&value, &number, sizeof(value));
+    return value;
+  }
+
+  // low 32 bits of a 64-bit register
+  std::string low(const std::string &name) {
+    if (name[1] >= '0' && name[1] <= '9')
+      return name + "d";
+    return "e" + name.substr(1);
+  }
+
+  std::string xmm(int n) {
+    return "xmm" + std::to_string(n);
+  }
+
+}
+
+//---------------------------------------------------------------------------
+
+const til::register_file &til::x86_64_writer::registers() {
+  static const register_file file = {
+    { "rdi", "rsi", "rcx", "r8", "r9", "r10", "rbx", "r12", "r13", "r14", "r15" },
+    { false, false, false, false, false, false, true, true, true, true, true },
+    8
+  };
+  return file;
+}
+
+std::string til::x86_64_writer::frame(int offset) const {
+  if (offset < 0)
+    return "[rbp" + std::to_string(offset) + "]";
+  return "[rbp+" + std::to_string(offset) + "]";
+}
+
+// register or frame slot of a virtual register
+std::string til::x86_64_writer::operand(int reg) const {
+  return operand(reg, _function->registers[reg]);
+}
+
+// the same, seen as a value of the given class (the low half of a pointer, for integers)
+std::string til::x86_64_writer::operand(int reg, ir::regclass c) const {
+  if (in_register(reg)) {
+    const std::string &name = registers().names[_function->machine[reg]];
+    return c == ir::INTEGER ? low(name) : name;
+  }
+  return std::string(c == ir::INTEGER ? "dword " : "qword ") + frame(_offsets[_function->home[reg]]);
+}
+
+// memory operand: spilled base and index registers are loaded into rax and rdx
+std::string til::x86_64_writer::address(const ir::memory &mem) {
+  std::string parts;
+  auto add = [&parts](const std::string &part) {
+    if (!parts.empty())
+      parts += "+";
+    parts += part;
+  };
+
+  int disp = mem.disp;
+  if (!mem.symbol.empty()) {
+    if (mem.base < 0 && mem.index < 0)
+      add(mem.symbol); // rip-relative
+    else {
+      op("lea", "r11, [" + mem.symbol + "]");
+      add("r11");
+    }
+  }
+  if (mem.slot >= 0) {
+    add("rbp");
+    disp += _offsets[mem.slot];
+  }
+  if (mem.base >= 0) {
+    if (in_register(mem.base))
+      add(operand(mem.base, ir::POINTER));
+    else {
+      op("mov", "rax, " + operand(mem.base, ir::POINTER));
+      add("rax");
+    }
+  }
+  if (mem.index >= 0) {
+    std::string index = "rdx";
+    if (in_register(mem.index))
+      index = operand(mem.index, ir::POINTER);
+    else
+      op("mov", "rdx, " + operand(mem.index, ir::POINTER));
+    add(mem.scale == 1 ? index : index + "*" + std::to_string(mem.scale));
+  }
+  if (disp != 0 || parts.empty()) {
+    if (disp < 0)
+      parts += std::to_string(disp);
+    else
+      add(std::to_string(disp));
+  }
+  return "[" + parts + "]";
+}
+
+// second operand of an integer operation
+std::string til::x86_64_writer::value(const ir::instruction &instr) const {
+  return instr.immediate ? std::to_string(instr.imm) : operand(instr.b);
+}
+
+void til::x86_64_writer::compare(int a, const std::string &b) {
+  if (in_register(a))
+    op("cmp", operand(a) + ", " + b);
+  else {
+    std::string scratch = _function->registers[a] == ir::INTEGER ? "eax" : "rax";
+    op("mov", scratch + ", " + operand(a));
+    op("cmp", scratch + ", " + b);
+  }
+}
+
+void til::x86_64_writer::set(const std::string &condition, int d) {
+  op("set" + condition, "al");
+  if (in_register(d))
+    op("movzx", operand(d) + ", al");
+  else {
+    op("movzx", "eax, al");
+    op("mov", operand(d) + ", eax");
+  }
+}
+
+// moves to registers, as if done at once (rax breaks cycles)
+void til::x86_64_writer::parallel(std::vector<move> moves) {
+  moves.erase(std::remove_if(moves.begin(), moves.end(), [](const move &m) {
+    return m.to == m.from;
+  }), moves.end());
+
+  while (!moves.empty()) {
+    // a move whose destination is not read by the others
+    auto ready = std::find_if(moves.begin(), moves.end(), [&moves](const move &m) {
+      return std::none_of(moves.begin(), moves.end(), [&m](const move &other) {
+        return &other != &m && other.from == m.to;
+      });
+    });
+    if (ready != moves.end()) {
+      bool memory = ready->from.find('[') != std::string::npos;
+      bool reg = !memory && !ready->from.empty() && ready->from[0] >= 'a' && ready->from[0] <= 'z';
+      op("mov", (reg || ready->wide ? ready->to : low(ready->to)) + ", " + ready->from);
+      moves.erase(ready);
+      continue;
+    }
+
+    // only cycles are left: save one destination, and read it from rax
+    std::string saved = moves.front().to;
+    op("mov", "rax, " + saved);
+    for (auto &m : moves)
+      if (m.from == saved)
+        m.from = "rax";
+  }
+}
+
+// the arguments of the function, from where the caller left them
+void til::x86_64_writer::parameters(const std::vector<ir::instruction> &code) {
+  std::vector<std::string> from(_function->arguments.size());
+  int integers = 0, doubles = 0, stack = 16; // after the return address and rbp
+  for (size_t i = 0; i < from.size(); i++) {
+    if (_function->arguments[i] == ir::DOUBLE && doubles < double_arguments)
+      from[i] = xmm(doubles++);
+    else if (_function->arguments[i] != ir::DOUBLE && integers < 6)
+      from[i] = integer_arguments[integers++];
+    else {
+      from[i] = frame(stack);
+      stack += 8;
+    }
+  }
+
+  // registers are read before they are overwritten: stores to memory first,
+  // then moves between registers, then loads from the stack
+  std::vector<move> moves;
+  std::vector<const ir::instruction*> loads;
+  for (const auto &instr : code) {
+    if (instr.op != ir::PARAM)
+      break;
+    const std::string &source = from[instr.imm];
+    ir::regclass c = _function->registers[instr.d];
+    if (c == ir::DOUBLE) {
+      if (source[0] == 'x')
+        op("movsd", operand(instr.d) + ", " + source);
+      else {
+        op("mov", "rax, " + source);
+        op("mov", operand(instr.d) + ", rax");
+      }
+    }
+    else if (!in_register(instr.d)) {
+      if (source[0] == '[') {
+        op("mov", "rax, " + source);
+        op("mov", operand(instr.d) + ", " + (c == ir::INTEGER ? "eax" : "rax"));
+      }
+      else
+        op("mov", operand(instr.d) + ", " + (c == ir::INTEGER ? low(source) : source));
+    }
+    else if (source[0] == '[')
+      loads.push_back(&instr);
+    else
+      moves.push_back({ registers().names[_function->machine[instr.d]], source, true });
+  }
+  parallel(moves);
+  for (auto instr : loads)
+    op("mov", operand(instr->d) + ", " + from[instr->imm]);
+}
+
+// the arguments (collected from the ARG instructions before it), the call and its result (or the tail call)
+void til::x86_64_writer::call(const ir::instruction &instr) {
+  std::vector<const ir::instruction*> arguments(_arguments.rbegin(), _arguments.rend());
+  _arguments.clear();
+
+  std::vector<move> moves;
+  std::vector<const ir::instruction*> stack;
+  int integers = 0, doubles = 0;
+  for (auto argument : arguments) {
+    bool real = !argument->immediate && _function->registers[argument->a] == ir::DOUBLE;
+    if (real && doubles < double_arguments)
+      op("movsd", xmm(doubles++) + ", " + operand(argument->a));
+    else if (!real && integers < 6) {
+      std::string to = integer_arguments[integers++];
+      if (argument->immediate)
+        moves.push_back({ to, std::to_string(argument->imm), false });
+      else if (in_register(argument->a))
+        moves.push_back({ to, operand(argument->a, ir::POINTER), true });
+      else
+        moves.push_back({ to, operand(argument->a), _function->registers[argument->a] != ir::INTEGER });
+    }
+    else
+      stack.push_back(argument);
+  }
+
+  // a tail call's stack arguments replace this function's (there are as many)
+  if (instr.op == ir::TAILCALL) {
+    int offset = 16; // after the return address and rbp
+    for (auto argument : stack) {
+      if (argument->immediate)
+        op("mov", "qword " + frame(offset) + ", " + std::to_string(argument->imm));
+      else if (in_register(argument->a))
+        op("mov", frame(offset) + ", " + operand(argument->a, ir::POINTER));
+      else {
+        bool integer = _function->registers[argument->a] == ir::INTEGER;
+        op("mov", std::string(integer ? "eax" : "rax") + ", " + operand(argument->a));
+        op("mov", frame(offset) + ", rax");
+      }
+      offset += 8;
+    }
+    parallel(moves);
+    epilogue(instr.label);
+    return;
+  }
+
+  // stack arguments (the last one first), keeping the stack aligned to 16 bytes
+  int pushed = stack.size() * 8;
+  if (stack.size() % 2) {
+    op("sub", "rsp, 8");
+    pushed += 8;
+  }
+  for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+    const ir::instruction &argument = **it;
+    if (argument.immediate)
+      op("push", "qword " + std::to_string(argument.imm));
+    else if (in_register(argument.a))
+      op("push", operand(argument.a, ir::POINTER));
+    else if (_function->registers[argument.a] == ir::INTEGER) {
+      op("mov", "eax, " + operand(argument.a));
+      op("push", "rax");
+    }
+    else
+      op("push", operand(argument.a));
+  }
+
+  // the callee's address must survive the moves to the argument registers
+  std::string callee = instr.label;
+  if (callee.empty()) {
+    moves.push_back({ "r11", operand(instr.a, ir::POINTER), true });
+    callee = "r11";
+  }
+  parallel(moves);
+  if (doubles > 0)
+    op("mov", "eax, " + std::to_string(doubles)); // for variadic functions
+
+  op("call", callee);
+  if (pushed)
+    op("add", "rsp, " + std::to_string(pushed));
+  if (instr.d < 0)
+    return;
+  if (instr.fpu)
+    op("movsd", operand(instr.d) + ", xmm0");
+  else
+    op("mov", operand(instr.d) + ", " + (_function->registers[instr.d] == ir::INTEGER ? "eax" : "rax"));
+}
+
+// return, or jump to the target (which returns to this function's caller)
+void til::x86_64_writer::epilogue(const std::string &target) {
+  for (const auto &[machine, offset] : _saved)
+    op("mov", registers().names[machine] + ", " + frame(offset));
+  op("leave");
+  if (target.empty())
+    op("ret");
+  else
+    op("jmp", target);
+}
+
+//---------------------------------------------------------------------------
+
+void til::x86_64_writer::write(const ir::module &module) {
+  op("default", "rel");
+  for (const auto &function : module.functions)
+    write(function);
+
+  write(".rodata", module.rodata);
+  write(".data", module.data);
+  write(".bss", module.bss);
+
+  for (const auto &name : module.externs)
+    op("extern", name);
+}
+
+void til::x86_64_writer::write(const std::string &segment, const std::vector<ir::datum> &data) {
+  if (data.empty())
+    return;
+
+  _os << "segment\t" << segment << '\n';
+  for (const auto &datum : data) {
+    op("align", "8");
+    if (datum.global)
+      _os << "global\t" << datum.label << ":object\n";
+    _os << datum.label << ":\n";
+
+    switch (datum.what) {
+      case ir::datum::INTEGER:
+        op("dd", std::to_string(datum.integer));
+        break;
+      case ir::datum::DOUBLE:
+        op("dq", hex(bits(datum.number)));
+        break;
+      case ir::datum::ADDRESS:
+        op("dq", datum.text.empty() ? "0" : datum.text);
+        break;
+      case ir::datum::SPACE:
+        op("resb", std::to_string(datum.integer));
+        break;
+      case ir::datum::STRING: {
+        // printable runs are quoted; everything else is written as numbers
+        std::string bytes, run;
+        auto flush = [&]() {
+          if (!run.empty())
+            bytes += (bytes.empty() ? "\"" : ", \"") + run + "\"";
+          run.clear();
+        };
+        for (unsigned char c : datum.text) {
+          if (c >= 32 && c < 127 && c != '"')
+            run += c;
+          else {
+            flush();
+            bytes += (bytes.empty() ? "" : ", ") + std::to_string(c);
+          }
+        }
+        flush();
+        op("db", bytes.empty() ? "0" : bytes + ", 0");
+        break;
+      }
+    }
+  }
+}
+
+void til::x86_64_writer::write(const ir::function &function) {
+  _function = &function;
+  _arguments.clear();
+
+  // frame layout: slots of 8 bytes or more aligned to 8, the frame to 16
+  int size = 0;
+  _offsets.assign(function.slots.size(), 0);
+  for (size_t s = 0; s < function.slots.size(); s++)
+    _offsets[s] = size = (size - function.slots[s].size) & (function.slots[s].size >= 8 ? -8 : -4);
+  _saved.clear();
+  std::vector<bool> used(registers().names.size(), false);
+  for (int machine : function.machine)
+    if (machine >= 0 && !used[machine]) {
+      used[machine] = true;
+      if (registers().preserved[machine])
+        _saved.emplace_back(machine, size = (size - 8) & -8);
+    }
+  size &= -16;
+
+  _os << "segment\t.text\n";
+  op("align", "16");
+  if (function.global)
+    _os << "global\t" << function.label << ":function\n";
+  _os << function.label << ":\n";
+  op("push", "rbp");
+  op("mov", "rbp, rsp");
+  if (size != 0)
+    op("sub", "rsp, " + std::to_string(-size));
+  for (const auto &[machine, offset] : _saved)
+    op("mov", frame(offset) + ", " + registers().names[machine]);
+
+  parameters(function.code);
+  for (const auto &instr : function.code)
+    write(instr);
+}
+
+//---------------------------------------------------------------------------
+
+void til::x86_64_writer::write(const ir::instruction &instr) {
+  const std::string D = instr.d >= 0 ? operand(instr.d) : "", A = instr.a >= 0 ? operand(instr.a) : "";
+  bool inD = instr.d >= 0 && in_register(instr.d);
+  bool wide = instr.d >= 0 && _function->registers[instr.d] == ir::POINTER;
+
+  // integer result computed in a scratch register when the destination is in memory
+  const std::string R = inD ? D : wide ? "rax" : "eax"; // where to compute the result
+  auto result = [&]() {
+    if (!inD)
+      op("mov", D + ", " + R);
+  };
+
+  // d = a op b, in place (d may be the same register as a or b)
+  auto arithmetic = [&](const std::string &name) {
+    const std::string B = value(instr);
+    if (R == B && R != A) {
+      if (instr.op == ir::SUB) {
+        op("neg", R);
+        op("add", R + ", " + A);
+      }
+      else
+        op(name, R + ", " + A);
+      return;
+    }
+    if (R != A)
+      op("mov", R + ", " + A);
+    op(name, R + ", " + B);
+    result();
+  };
+
+  switch (instr.op) {
+    case ir::MOVI:
+      op("mov", D + ", " + std::to_string(instr.imm));
+      break;
+    case ir::MOV:
+      if (D == A)
+        break;
+      if (inD || in_register(instr.a))
+        op("mov", D + ", " + A);
+      else {
+        op("mov", R + ", " + A);
+        result();
+      }
+      break;
+    case ir::LA:
+      op("lea", R + ", [" + instr.label + "]");
+      result();
+      break;
+    case ir::LEA:
+      op("lea", R + ", " + address(instr.mem));
+      result();
+      break;
+    case ir::LOAD:
+      op("mov", R + ", " + address(instr.mem));
+      result();
+      break;
+    case ir::STORE:
+      if (in_register(instr.a))
+        op("mov", address(instr.mem) + ", " + A);
+      else {
+        std::string scratch = _function->registers[instr.a] == ir::INTEGER ? "r11d" : "r11";
+        op("mov", scratch + ", " + A);
+        op("mov", address(instr.mem) + ", " + scratch);
+      }
+      break;
+
+    case ir::NEG:
+      if (R != A)
+        op("mov", R + ", " + A);
+      op("neg", R);
+      result();
+      break;
+    case ir::NOT:
+      compare(instr.a, "0");
+      set("e", instr.d);
+      break;
+    case ir::ADD:
+      arithmetic("add");
+      break;
+    case ir::SUB:
+      arithmetic("sub");
+      break;
+    case ir::MUL:
+      if (instr.immediate) {
+        op("imul", R + ", " + A + ", " + std::to_string(instr.imm));
+        result();
+      }
+      else
+        arithmetic("imul");
+      break;
+    case ir::DIV:
+    case ir::MOD:
+      op("mov", std::string(wide ? "rax, " : "eax, ") + A);
+      op(wide ? "cqo" : "cdq");
+      op("idiv", value(instr));
+      op("mov", D + ", " + (instr.op == ir::DIV ? (wide ? "rax" : "eax") : (wide ? "rdx" : "edx")));
+      break;
+    case ir::SET:
+      compare(instr.a, value(instr));
+      set(signed_conditions[instr.cond], instr.d);
+      break;
+
+    case ir::LABEL:
+      _os << instr.label << ":\n";
+      break;
+    case ir::JMP:
+      op("jmp", instr.label);
+      break;
+    case ir::JZ:
+    case ir::JNZ:
+      compare(instr.a, "0");
+      op(instr.op == ir::JZ ? "je" : "jne", instr.label);
+      break;
+    case ir::JCOND:
+      compare(instr.a, value(instr));
+      op(std::string("j") + signed_conditions[instr.cond], instr.label);
+      break;
+
+    case ir::I2P:
+      op("movsxd", (inD ? D : "rax") + ", " + operand(instr.a, ir::INTEGER));
+      result();
+      break;
+    case ir::P2I:
+      if (R != operand(instr.a, ir::INTEGER))
+        op("mov", R + ", " + operand(instr.a, ir::INTEGER));
+      result();
+      break;
+    case ir::ALLOCA:
+      op("mov", "rax, " + A);
+      op("add", "rax, 15");
+      op("and", "rax, -16");
+      op("sub", "rsp, rax");
+      op("mov", D + ", rsp");
+      break;
+    case ir::PARAM:
+      break; // see parameters()
+    case ir::ARG:
+      _arguments.push_back(&instr);
+      break;
+    case ir::CALL:
+    case ir::TAILCALL:
+      call(instr);
+      break;
+    case ir::RET:
+      if (instr.immediate)
+        op("mov", "eax, " + std::to_string(instr.imm));
+      else if (instr.a >= 0) {
+        switch (_function->registers[instr.a]) {
+          case ir::DOUBLE:
+            op("movsd", "xmm0, " + A);
+            break;
+          case ir::POINTER:
+            op("mov", "rax, " + A);
+            break;
+          default:
+            op("mov", "eax, " + A);
+        }
+      }
+      epilogue();
+      break;
+
+    case ir::DMOVI:
+      op("mov", "rax, " + hex(bits(instr.number)));
+      op("mov", D + ", rax");
+      break;
+    case ir::DMOV:
+      op("mov", "rax, " + A);
+      op("mov", D + ", rax");
+      break;
+    case ir::DLOAD:
+      op("movsd", "xmm0, qword " + address(instr.mem));
+      op("movsd", D + ", xmm0");
+      break;
+    case ir::DSTORE:
+      op("movsd", "xmm0, " + A);
+      op("movsd", "qword " + address(instr.mem) + ", xmm0");
+      break;
+    case ir::I2D:
+      op("cvtsi2sd", "xmm0, " + A);
+      op("movsd", D + ", xmm0");
+      break;
+    case ir::D2I:
+      op("cvtsd2si", R + ", " + A); // rounds to nearest, as fistp
+      result();
+      break;
+    case ir::DNEG:
+      op("mov", "rax, " + A);
+      op("btc", "rax, 63");
+      op("mov", D + ", rax");
+      break;
+    case ir::DADD:
+    case ir::DSUB:
+    case ir::DMUL:
+    case ir::DDIV: {
+      static const char *names[] = { "addsd", "subsd", "mulsd", "divsd" };
+      op("movsd", "xmm0, " + A);
+      op(names[instr.op - ir::DADD], "xmm0, " + operand(instr.b));
+      op("movsd", D + ", xmm0");
+      break;
+    }
+    case ir::DSET:
+      op("movsd", "xmm0, " + A);
+      op("ucomisd", "xmm0, " + operand(instr.b));
+      set(unsigned_conditions[instr.cond], instr.d);
+      break;
+  }
+}
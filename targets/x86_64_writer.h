@@ -0,0 +1,76 @@
+#ifndef __TIL_TARGETS_X86_64_WRITER_H__
+#define __TIL_TARGETS_X86_64_WRITER_H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "targets/ir.h"
+#include "targets/linear_scan.h"
+
+namespace til {
+
+  /**
+   * Write allocated register IR as NASM assembly for x86-64 (ELF, not
+   * position independent). Frames are addressed from rbp; rax, rdx and
+   * r11 are scratch registers; doubles go through xmm0 and xmm1 (SSE2),
+   * from and to their frame slots. Functions follow the System V calling
+   * convention: the first arguments in rdi, rsi, rdx, rcx, r8 and r9 (or
+   * xmm0-xmm7, for doubles), the others on the stack; results in eax, rax
+   * or xmm0.
+   */
+  class x86_64_writer {
+    std::ostream &_os;
+    const ir::function *_function = nullptr;
+    std::vector<int> _offsets;                      // of each frame slot, from rbp
+    std::vector<std::pair<int, int>> _saved;        // preserved registers used: machine register, offset
+    std::vector<const ir::instruction*> _arguments; // of the next call (the last one first)
+
+    // a move to a machine register, as part of a parallel move
+    struct move {
+      std::string to;   // 64-bit register
+      std::string from; // register (64-bit), memory or immediate
+      bool wide;        // all 64 bits of a memory operand
+    };
+
+  public:
+    x86_64_writer(std::ostream &os) :
+        _os(os) {
+    }
+
+  public:
+    /** Registers for the allocator: the argument registers, r10, and the ones preserved by calls. */
+    static const register_file &registers();
+
+    void write(const ir::module &module);
+
+  private:
+    void write(const ir::function &function);
+    void write(const ir::instruction &instr);
+    void write(const std::string &segment, const std::vector<ir::datum> &data);
+
+    void op(const std::string &name, const std::string &args = "") {
+      _os << '\t' << name;
+      if (!args.empty())
+        _os << '\t' << args;
+      _os << '\n';
+    }
+
+    bool in_register(int reg) const {
+      return _function->machine[reg] >= 0;
+    }
+    std::string frame(int offset) const;
+    std::string operand(int reg) const;
+    std::string operand(int reg, ir::regclass c) const;
+    std::string address(const ir::memory &mem);
+    std::string value(const ir::instruction &instr) const;
+    void compare(int a, const std::string &b);
+    void set(const std::string &condition, int d);
+    void parallel(std::vector<move> moves);
+    void parameters(const std::vector<ir::instruction> &code);
+    void call(const ir::instruction &instr);
+    void epilogue(const std::string &target = "");
+  };
+
+} // til
+
+#endif
@@ -0,0 +1,465 @@
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include "targets/x86_writer.h"
+
+//---------------------------------------------------------------------------
+
+namespace {
+
+  const char *signed_conditions[] = { "e", "ne", "l", "le", "g", "ge" };
+  const char *unsigned_conditions[] = { "e", "ne", "b", "be", "a", "ae" }; // after fcomip
+
+  std::string hex(uint64_t value) {
+    std::ostringstream out;
+    out << "0x" << std::hex << value;
+    return out.str();
+  }
+
+  uint64_t bits(double number) {
+    uint64_t value;
+    std::memcpy(&value, &number, sizeof(value));
+    return value;
+  }
+
+}
+
+//---------------------------------------------------------------------------
+
+const til::register_file &til::x86_writer::registers() {
+  static const register_file file = { { "ebx", "esi", "edi", "ecx" }, { true, true, true, false } };
+  return file;
+}
+
+std::string til::x86_writer::frame(int offset) const {
+  if (offset < 0)
+    return "[ebp" + std::to_string(offset) + "]";
+  return "[ebp+" + std::to_string(offset) + "]";
+}
+
+// register or frame slot of a virtual register
+std::string til::x86_writer::operand(int reg) const {
+  if (in_register(reg))
+    return registers().names[_function->machine[reg]];
+  return std::string(_function->registers[reg] == ir::DOUBLE ? "qword " : "dword ") + frame(_offsets[_function->home[reg]]);
+}
+
+// low (0) or high (4) half of a double register
+std::string til::x86_writer::half(int reg, int part) const {
+  return "dword " + frame(_offsets[_function->home[reg]] + part);
+}
+
+// memory operand: spilled base and index registers are loaded into eax and edx
+std::string til::x86_writer::address(const ir::memory &mem) {
+  std::string parts;
+  auto add = [&parts](const std::string &part) {
+    if (!parts.empty())
+      parts += "+";
+    parts += part;
+  };
+
+  int disp = mem.disp;
+  if (!mem.symbol.empty())
+    add(mem.symbol);
+  if (mem.slot >= 0) {
+    add("ebp");
+    disp += _offsets[mem.slot];
+  }
+  if (mem.base >= 0) {
+    if (in_register(mem.base))
+      add(operand(mem.base));
+    else {
+      op("mov", "eax, " + operand(mem.base));
+      add("eax");
+    }
+  }
+  if (mem.index >= 0) {
+    std::string index = "edx";
+    if (in_register(mem.index))
+      index = operand(mem.index);
+    else
+      op("mov", "edx, " + operand(mem.index));
+    add(mem.scale == 1 ? index : index + "*" + std::to_string(mem.scale));
+  }
+  if (disp != 0 || parts.empty()) {
+    if (disp < 0)
+      parts += std::to_string(disp);
+    else
+      add(std::to_string(disp));
+  }
+  return "[" + parts + "]";
+}
+
+// second operand of an integer operation
+std::string til::x86_writer::value(const ir::instruction &instr) const {
+  return instr.immediate ? std::to_string(instr.imm) : operand(instr.b);
+}
+
+void til::x86_writer::compare(int a, const std::string &b) {
+  if (in_register(a))
+    op("cmp", operand(a) + ", " + b);
+  else {
+    op("mov", "eax, " + operand(a));
+    op("cmp", "eax, " + b);
+  }
+}
+
+void til::x86_writer::set(const std::string &condition, int d) {
+  op("set" + condition, "al");
+  if (in_register(d))
+    op("movzx", operand(d) + ", al");
+  else {
+    op("movzx", "eax, al");
+    op("mov", operand(d) + ", eax");
+  }
+}
+
+// return, or jump to the target (which returns to this function's caller)
+void til::x86_writer::epilogue(const std::string &target) {
+  for (const auto &[machine, offset] : _saved)
+    op("mov", registers().names[machine] + ", " + frame(offset));
+  op("leave");
+  if (target.empty())
+    op("ret");
+  else
+    op("jmp", target);
+}
+
+//---------------------------------------------------------------------------
+
+void til::x86_writer::write(const ir::module &module) {
+  for (const auto &function : module.functions)
+    write(function);
+
+  write(".rodata", module.rodata);
+  write(".data", module.data);
+  write(".bss", module.bss);
+
+  for (const auto &name : module.externs)
+    op("extern", name);
+}
+
+void til::x86_writer::write(const std::string &segment, const std::vector<ir::datum> &data) {
+  if (data.empty())
+    return;
+
+  _os << "segment\t" << segment << '\n';
+  for (const auto &datum : data) {
+    op("align", "4");
+    if (datum.global)
+      _os << "global\t" << datum.label << ":object\n";
+    _os << datum.label << ":\n";
+
+    switch (datum.what) {
+      case ir::datum::INTEGER:
+        op("dd", std::to_string(datum.integer));
+        break;
+      case ir::datum::DOUBLE:
+        op("dq", hex(bits(datum.number)));
+        break;
+      case ir::datum::ADDRESS:
+        op("dd", datum.text.empty() ? "0" : datum.text);
+        break;
+      case ir::datum::SPACE:
+        op("resb", std::to_string(datum.integer));
+        break;
+      case ir::datum::STRING: {
+        // printable runs are quoted; everything else is written as numbers
+        std::string bytes, run;
+        auto flush = [&]() {
+          if (!run.empty())
+            bytes += (bytes.empty() ? "\"" : ", \"") + run + "\"";
+          run.clear();
+        };
+        for (unsigned char c : datum.text) {
+          if (c >= 32 && c < 127 && c != '"')
+            run += c;
+          else {
+            flush();
+            bytes += (bytes.empty() ? "" : ", ") + std::to_string(c);
+          }
+        }
+        flush();
+        op("db", bytes.empty() ? "0" : bytes + ", 0");
+        break;
+      }
+    }
+  }
+}
+
+void til::x86_writer::write(const ir::function &function) {
+  _function = &function;
+
+  // frame layout: arguments above ebp (after the return address), the rest below
+  _arguments.clear();
+  int offset = 8;
+  for (auto c : function.arguments) {
+    _arguments.push_back(offset);
+    offset += c == ir::DOUBLE ? 8 : 4;
+  }
+  int size = 0;
+  _offsets.assign(function.slots.size(), 0);
+  for (size_t s = 0; s < function.slots.size(); s++)
+    _offsets[s] = size -= function.slots[s].size;
+  _saved.clear();
+  std::vector<bool> used(registers().names.size(), false);
+  for (int machine : function.machine)
+    if (machine >= 0 && !used[machine]) {
+      used[machine] = true;
+      if (registers().preserved[machine])
+        _saved.emplace_back(machine, size -= 4);
+    }
+
+  _os << "segment\t.text\n";
+  op("align", "4");
+  if (function.global)
+    _os << "global\t" << function.label << ":function\n";
+  _os << function.label << ":\n";
+  op("push", "ebp");
+  op("mov", "ebp, esp");
+  if (size != 0)
+    op("sub", "esp, " + std::to_string(-size));
+  for (const auto &[machine, offset] : _saved)
+    op("mov", frame(offset) + ", " + registers().names[machine]);
+
+  for (const auto &instr : function.code)
+    write(instr);
+}
+
+//---------------------------------------------------------------------------
+
+void til::x86_writer::write(const ir::instruction &instr) {
+  const std::string D = instr.d >= 0 ? operand(instr.d) : "", A = instr.a >= 0 ? operand(instr.a) : "";
+  bool inD = instr.d >= 0 && in_register(instr.d);
+
+  // integer result computed in a scratch register when the destination is in memory
+  auto result = [&]() {
+    if (!inD)
+      op("mov", D + ", eax");
+  };
+  const std::string R = inD ? D : "eax"; // where to compute the result
+
+  // d = a op b, in place (d may be the same register as a or b)
+  auto arithmetic = [&](const std::string &name) {
+    const std::string B = value(instr);
+    if (R == B && R != A) {
+      if (instr.op == ir::SUB) {
+        op("neg", R);
+        op("add", R + ", " + A);
+      }
+      else
+        op(name, R + ", " + A);
+      return;
+    }
+    if (R != A)
+      op("mov", R + ", " + A);
+    op(name, R + ", " + B);
+    result();
+  };
+
+  switch (instr.op) {
+    case ir::MOVI:
+      op("mov", D + ", " + std::to_string(instr.imm));
+      break;
+    case ir::MOV:
+    case ir::I2P: // ints and pointers have the same size
+    case ir::P2I:
+      if (D == A)
+        break;
+      if (inD || in_register(instr.a))
+        op("mov", D + ", " + A);
+      else {
+        op("mov", "eax, " + A);
+        result();
+      }
+      break;
+    case ir::LA:
+      op("mov", D + ", " + instr.label);
+      break;
+    case ir::LEA:
+      op("lea", R + ", " + address(instr.mem));
+      result();
+      break;
+    case ir::LOAD:
+      op("mov", R + ", " + address(instr.mem));
+      result();
+      break;
+    case ir::STORE:
+      if (in_register(instr.a))
+        op("mov", address(instr.mem) + ", " + A);
+      else {
+        op("lea", "eax, " + address(instr.mem));
+        op("mov", "edx, " + A);
+        op("mov", "[eax], edx");
+      }
+      break;
+
+    case ir::NEG:
+      if (R != A)
+        op("mov", R + ", " + A);
+      op("neg", R);
+      result();
+      break;
+    case ir::NOT:
+      compare(instr.a, "0");
+      set("e", instr.d);
+      break;
+    case ir::ADD:
+      arithmetic("add");
+      break;
+    case ir::SUB:
+      arithmetic("sub");
+      break;
+    case ir::MUL:
+      if (instr.immediate) {
+        op("imul", R + ", " + A + ", " + std::to_string(instr.imm));
+        result();
+      }
+      else
+        arithmetic("imul");
+      break;
+    case ir::DIV:
+    case ir::MOD:
+      op("mov", "eax, " + A);
+      op("cdq");
+      op("idiv", value(instr));
+      op("mov", D + ", " + (instr.op == ir::DIV ? "eax" : "edx"));
+      break;
+    case ir::SET:
+      compare(instr.a, value(instr));
+      set(signed_conditions[instr.cond], instr.d);
+      break;
+
+    case ir::LABEL:
+      _os << instr.label << ":\n";
+      break;
+    case ir::JMP:
+      op("jmp", instr.label);
+      break;
+    case ir::JZ:
+    case ir::JNZ:
+      compare(instr.a, "0");
+      op(instr.op == ir::JZ ? "je" : "jne", instr.label);
+      break;
+    case ir::JCOND:
+      compare(instr.a, value(instr));
+      op(std::string("j") + signed_conditions[instr.cond], instr.label);
+      break;
+
+    case ir::ALLOCA:
+      op("sub", "esp, " + A);
+      op("mov", D + ", esp");
+      break;
+    case ir::PARAM:
+      if (_function->registers[instr.d] == ir::DOUBLE) {
+        op("fld", "qword " + frame(_arguments[instr.imm]));
+        op("fstp", D);
+      }
+      else if (inD)
+        op("mov", D + ", " + frame(_arguments[instr.imm]));
+      else {
+        op("mov", "eax, " + frame(_arguments[instr.imm]));
+        result();
+      }
+      break;
+    case ir::ARG:
+      if (instr.immediate)
+        op("push", "dword " + std::to_string(instr.imm));
+      else if (_function->registers[instr.a] == ir::DOUBLE) {
+        op("push", half(instr.a, 4));
+        op("push", half(instr.a, 0));
+      }
+      else
+        op("push", A);
+      break;
+    case ir::CALL:
+      op("call", instr.label.empty() ? A : instr.label);
+      if (instr.imm)
+        op("add", "esp, " + std::to_string(instr.imm));
+      if (instr.fpu)
+        op("fstp", instr.d >= 0 ? operand(instr.d) : "st0");
+      else if (instr.d >= 0)
+        op("mov", D + ", eax");
+      break;
+    case ir::TAILCALL:
+      // the pushed arguments replace this function's
+      for (int offset = 0; offset < instr.imm; offset += 4) {
+        op("mov", "eax, [esp+" + std::to_string(offset) + "]");
+        op("mov", frame(8 + offset) + ", eax");
+      }
+      epilogue(instr.label);
+      break;
+    case ir::RET:
+      if (instr.immediate)
+        op("mov", "eax, " + std::to_string(instr.imm));
+      else if (instr.a >= 0) {
+        if (_function->registers[instr.a] == ir::DOUBLE)
+          op("fld", operand(instr.a));
+        else
+          op("mov", "eax, " + A);
+      }
+      epilogue();
+      break;
+
+    case ir::DMOVI: {
+      uint64_t value = bits(instr.number);
+      op("mov", half(instr.d, 0) + ", " + hex(value & 0xffffffff));
+      op("mov", half(instr.d, 4) + ", " + hex(value >> 32));
+      break;
+    }
+    case ir::DMOV:
+      op("fld", operand(instr.a));
+      op("fstp", operand(instr.d));
+      break;
+    case ir::DLOAD:
+      op("fld", "qword " + address(instr.mem));
+      op("fstp", operand(instr.d));
+      break;
+    case ir::DSTORE:
+      op("fld", operand(instr.a));
+      op("fstp", "qword " + address(instr.mem));
+      break;
+    case ir::I2D:
+      if (in_register(instr.a)) {
+        op("push", A);
+        op("fild", "dword [esp]");
+        op("add", "esp, 4");
+      }
+      else
+        op("fild", A);
+      op("fstp", operand(instr.d));
+      break;
+    case ir::D2I:
+      op("fld", operand(instr.a));
+      if (inD) {
+        op("sub", "esp, 4");
+        op("fistp", "dword [esp]");
+        op("pop", D);
+      }
+      else
+        op("fistp", D);
+      break;
+    case ir::DNEG:
+      op("fld", operand(instr.a));
+      op("fchs");
+      op("fstp", operand(instr.d));
+      break;
+    case ir::DADD:
+    case ir::DSUB:
+    case ir::DMUL:
+    case ir::DDIV: {
+      static const char *names[] = { "fadd", "fsub", "fmul", "fdiv" };
+      op("fld", operand(instr.a));
+      op(names[instr.op - ir::DADD], operand(instr.b));
+      op("fstp", operand(instr.d));
+      break;
+    }
+    case ir::DSET:
+      op("fld", operand(instr.b));
+      op("fld", operand(instr.a));
+      op("fcomip", "st0, st1");
+      op("fstp", "st0");
+      set(unsigned_conditions[instr.cond], instr.d);
+      break;
+  }
+}
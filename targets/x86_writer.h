@@ -0,0 +1,64 @@
+#ifndef __TIL_TARGETS_X86_WRITER_H__
+#define __TIL_TARGETS_X86_WRITER_H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "targets/ir.h"
+#include "targets/linear_scan.h"
+
+namespace til {
+
+  /**
+   * Write allocated register IR as NASM assembly for ix86. Frames are
+   * addressed from ebp; eax and edx are scratch registers; doubles go
+   * through the x87 stack, from and to their frame slots. Functions
+   * follow the calling convention of the postfix target (arguments on
+   * the stack, results in eax or st0).
+   */
+  class x86_writer {
+    std::ostream &_os;
+    const ir::function *_function = nullptr;
+    std::vector<int> _offsets;                      // of each frame slot, from ebp
+    std::vector<int> _arguments;                    // of each argument, from ebp
+    std::vector<std::pair<int, int>> _saved;        // preserved registers used: machine register, offset
+
+  public:
+    x86_writer(std::ostream &os) :
+        _os(os) {
+    }
+
+  public:
+    /** Registers for the allocator: the ones preserved by the C calling convention, and ecx. */
+    static const register_file &registers();
+
+    void write(const ir::module &module);
+
+  private:
+    void write(const ir::function &function);
+    void write(const ir::instruction &instr);
+    void write(const std::string &segment, const std::vector<ir::datum> &data);
+
+    void op(const std::string &name, const std::string &args = "") {
+      _os << '\t' << name;
+      if (!args.empty())
+        _os << '\t' << args;
+      _os << '\n';
+    }
+
+    bool in_register(int reg) const {
+      return _function->machine[reg] >= 0;
+    }
+    std::string frame(int offset) const;
+    std::string operand(int reg) const;
+    std::string half(int reg, int part) const;
+    std::string address(const ir::memory &mem);
+    std::string value(const ir::instruction &instr) const;
+    void compare(int a, const std::string &b);
+    void set(const std::string &condition, int d);
+    void epilogue(const std::string &target = "");
+  };
+
+} // til
+
+#endif
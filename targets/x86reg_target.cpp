@@ -0,0 +1,7 @@
+#include "targets/x86reg_target.h"
+
+/**
+ * Register-allocated ix86.
+ * @var create and register an evaluator for X86REG targets.
+ */
+til::x86reg_target til::x86reg_target::_self;
@@ -0,0 +1,25 @@
+#ifndef __TIL_TARGETS_X86REG_TARGET_H__
+#define __TIL_TARGETS_X86REG_TARGET_H__
+
+#include "targets/register_target.h"
+#include "targets/x86_writer.h"
+
+namespace til {
+
+  /**
+   * ix86 code with register allocation, written as NASM assembly (as for
+   * the "asm" target).
+   */
+  class x86reg_target: public register_target<x86_writer, 4> {
+    static x86reg_target _self;
+
+  private:
+    x86reg_target() :
+        register_target("x86reg") {
+    }
+
+  };
+
+} // til
+
+#endif
@@ -19,7 +19,7 @@ namespace til {
     bool evaluate(std::shared_ptr<cdk::compiler> compiler) {
       // this symbol table will be used to check identifiers
       // an exception will be thrown if identifiers are used before declaration
-      cdk::symbol_table<til::symbol> symtab;
+      til::scope_table<til::symbol> symtab;
 
       xml_writer writer(compiler, symtab);
       compiler->ast()->accept(&writer, 0);
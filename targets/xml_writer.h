@@ -2,6 +2,7 @@
 #define __TIL_TARGETS_XML_WRITER_H__
 
 #include "targets/basic_ast_visitor.h"
+#include "targets/scope_table.h"
 #include <cdk/ast/basic_node.h>
 
 namespace til {
@@ -10,10 +11,10 @@ namespace til {
    * Print nodes as XML elements to the output stream.
    */
   class xml_writer: public basic_ast_visitor {
-    cdk::symbol_table<til::symbol> &_symtab;
+    til::scope_table<til::symbol> &_symtab;
 
   public:
-    xml_writer(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<til::symbol> &symtab) :
+    xml_writer(std::shared_ptr<cdk::compiler> compiler, til::scope_table<til::symbol> &symtab) :
         basic_ast_visitor(compiler), _symtab(symtab) {
     }
 
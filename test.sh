@@ -11,6 +11,20 @@ FAIL='\033[0;31mFAILED\033[0m'
 # Log file
 LOGFILE=log.md
 
+# Compiler target (asm, x86reg or x86_64)
+TARGET=${TARGET:-asm}
+
+# Object format, linker and runtime library for the target
+if [ "$TARGET" = "x86_64" ]; then
+  OBJ_FORMAT=elf64
+  LINKER=(cc -no-pie -nostartfiles)
+  RTS_LIB_DIR=rts64
+else
+  OBJ_FORMAT=elf32
+  LINKER=(ld -melf_i386)
+  RTS_LIB_DIR=$HOME/compiladores/root/usr/lib
+fi
+
 # Tex Color to md
 LOG_PASS='$\\color{green}{\\textbf{PASSED}}$'
 LOG_FAIL='$\\color{red}{\\textbf{FAILED}}$'
@@ -32,7 +46,7 @@ fi
 
 # Compile the project
 echo "Compiling the project..."
-make > /dev/null
+make > /dev/null && { [ "$TARGET" != "x86_64" ] || make rts64/librts.a > /dev/null; }
 if [ $? -ne 0 ]; then
   echo "Compilation failed"
   if $ALL_TESTS
@@ -61,9 +75,9 @@ do
   # Generate assembly code
   if $ALL_TESTS
   then
-    ./til -g --target asm $test_file > /dev/null 2>&1
+    ./til -g --target $TARGET -o $asm_file $test_file > /dev/null 2>&1
   else
-    ./til -g --target asm $test_file
+    ./til -g --target $TARGET -o $asm_file $test_file
   fi
 
   if [ $? -ne 0 ]; then
@@ -79,9 +93,9 @@ do
   # Assemble the .asm file
   if $ALL_TESTS
   then
-    yasm -felf32 -o $obj_file $asm_file > /dev/null 2>&1
+    yasm -f$OBJ_FORMAT -o $obj_file $asm_file > /dev/null 2>&1
   else
-    yasm -felf32 -o $obj_file $asm_file
+    yasm -f$OBJ_FORMAT -o $obj_file $asm_file
   fi
 
   if [ $? -ne 0 ]; then
@@ -97,9 +111,9 @@ do
   # Link the object file
   if $ALL_TESTS
   then
-    ld -melf_i386 -o $exec_file $obj_file -L$HOME/compiladores/root/usr/lib -lrts > /dev/null 2>&1
+    "${LINKER[@]}" -o $exec_file $obj_file -L$RTS_LIB_DIR -lrts > /dev/null 2>&1
   else
-    ld -melf_i386 -o $exec_file $obj_file -L$HOME/compiladores/root/usr/lib -lrts
+    "${LINKER[@]}" -o $exec_file $obj_file -L$RTS_LIB_DIR -lrts
   fi
 
   if [ $? -ne 0 ]; then
@@ -125,8 +139,11 @@ do
     continue
   fi
 
-  # Compare the output with the expected output
-  diff -iwub =(tr -d '[:space:]' < $out_file) =(tr -d '[:space:]' < $EXPECTED_DIR/$test_name.out) > /dev/null
+  # Compare the output with the expected output (a target may have its own,
+  # e.g., x86_64 for the sizeof of 8-byte pointers)
+  expected_file=$EXPECTED_DIR/$TARGET/$test_name.out
+  [ -f $expected_file ] || expected_file=$EXPECTED_DIR/$test_name.out
+  diff -iwub =(tr -d '[:space:]' < $out_file) =(tr -d '[:space:]' < $expected_file) > /dev/null
   if [ $? -eq 0 ]; then
     echo -e "Test $test_name: $PASS"
     if $ALL_TESTS
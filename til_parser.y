@@ -11,6 +11,43 @@
 #define yyerror(compiler, s)         compiler->scanner()->error(s)
 //-- don't change *any* of these --- END!
 
+#include "arena.h"
+#include "targets/types.h"
+#define ARENA                        til::arena::ast()
+
+// Bison does not grow the stacks of C++ semantic values itself. Ours are raw
+// storage (the destructor does nothing), but bison assigns to a slot as if it
+// held a std::shared_ptr: the stacks start at bison's default depth and grow
+// into constructed slots, where the values in use are copied bytewise.
+#define YYMAXDEPTH                   10000
+#define yyoverflow(message, states, statesSize, values, valuesSize, depth) \
+  do { if (!grow_stacks(states, statesSize, values, valuesSize, depth)) YYNOMEM; } while (0)
+
+template<typename State, typename Value, typename Size>
+bool grow_stacks(State **states, size_t statesSize, Value **values, size_t valuesSize, Size *depth) {
+  static std::unique_ptr<State[]> ownStates; // the initial stacks are bison's
+  static std::unique_ptr<Value[]> ownValues;
+  if (*depth >= YYMAXDEPTH)
+    return false;
+  *depth = std::min<Size>(*depth * 2, YYMAXDEPTH);
+  std::unique_ptr<State[]> newStates(new State[*depth]);
+  std::unique_ptr<Value[]> newValues(new Value[*depth]);
+  std::memcpy(newStates.get(), *states, statesSize);
+  std::memcpy(static_cast<void*>(newValues.get()), *values, valuesSize);
+  *states = (ownStates = std::move(newStates)).get();
+  *values = (ownValues = std::move(newValues)).get();
+  return true;
+}
+
+// Nodes and token text live in the compilation's arena, which destroys them:
+// sequences do not delete their elements. The root sequence is handed to the
+// compiler, which may delete it, so it is heap-allocated.
+class arena_sequence_node : public cdk::sequence_node {
+public:
+  using cdk::sequence_node::sequence_node;
+  ~arena_sequence_node() { nodes().clear(); }
+};
+
 std::vector<std::shared_ptr<cdk::basic_type>> sequenceToTypes(cdk::sequence_node *const node) {
   std::vector<std::shared_ptr<cdk::basic_type>> types;
 
@@ -71,48 +108,48 @@ std::vector<std::shared_ptr<cdk::basic_type>> sequenceToTypes(cdk::sequence_node
 
 %%
 
-file : /* empty */          { compiler->ast($$ = new cdk::sequence_node(LINE)); }
-     | declarations         { compiler->ast($$ = $1); }
-     | program              { compiler->ast($$ = new cdk::sequence_node(LINE, $1)); }
-     | declarations program { compiler->ast($$ = new cdk::sequence_node(LINE, $2, $1)); }
+file : /* empty */          { compiler->ast($$ = new arena_sequence_node(LINE)); }
+     | declarations         { compiler->ast($$ = new arena_sequence_node(LINE)); $$->nodes().swap($1->nodes()); }
+     | program              { compiler->ast($$ = new arena_sequence_node(LINE)); $$->nodes().push_back($1); }
+     | declarations program { compiler->ast($$ = new arena_sequence_node(LINE)); $$->nodes().swap($1->nodes()); $$->nodes().push_back($2); }
      ;
 
 declaration : block_declaration                           { $$ = $1; }
-            | '(' tPUBLIC type tIDENTIFIER ')'            { $$ = new til::variable_declaration_node(LINE, tPUBLIC, $3, *$4, nullptr); delete $4; }
-            | '(' tPUBLIC type tIDENTIFIER expression ')' { $$ = new til::variable_declaration_node(LINE, tPUBLIC, $3, *$4, $5); delete $4; }
-            | '(' tFORWARD type tIDENTIFIER ')'           { $$ = new til::variable_declaration_node(LINE, tFORWARD, $3, *$4, nullptr); delete $4; }
-            | '(' tEXTERNAL type tIDENTIFIER ')'          { $$ = new til::variable_declaration_node(LINE, tEXTERNAL, $3, *$4, nullptr); delete $4; }
+            | '(' tPUBLIC type tIDENTIFIER ')'            { $$ = ARENA.make<til::variable_declaration_node>(LINE, tPUBLIC, $3, *$4, nullptr); }
+            | '(' tPUBLIC type tIDENTIFIER expression ')' { $$ = ARENA.make<til::variable_declaration_node>(LINE, tPUBLIC, $3, *$4, $5); }
+            | '(' tFORWARD type tIDENTIFIER ')'           { $$ = ARENA.make<til::variable_declaration_node>(LINE, tFORWARD, $3, *$4, nullptr); }
+            | '(' tEXTERNAL type tIDENTIFIER ')'          { $$ = ARENA.make<til::variable_declaration_node>(LINE, tEXTERNAL, $3, *$4, nullptr); }
             /* var */
-            | '(' tPUBLIC tVAR tIDENTIFIER expression ')' { $$ = new til::variable_declaration_node(LINE, tPUBLIC, nullptr, *$4, $5); delete $4; }
-            | '(' tPUBLIC tIDENTIFIER expression ')'      { $$ = new til::variable_declaration_node(LINE, tPUBLIC, nullptr, *$3, $4); delete $3; }
+            | '(' tPUBLIC tVAR tIDENTIFIER expression ')' { $$ = ARENA.make<til::variable_declaration_node>(LINE, tPUBLIC, nullptr, *$4, $5); }
+            | '(' tPUBLIC tIDENTIFIER expression ')'      { $$ = ARENA.make<til::variable_declaration_node>(LINE, tPUBLIC, nullptr, *$3, $4); }
             ;
 
-declarations : declaration              { $$ = new cdk::sequence_node(LINE, $1); }
-             | declarations declaration { $$ = new cdk::sequence_node(LINE, $2, $1); }
+declarations : declaration              { $$ = ARENA.make<arena_sequence_node>(LINE, $1); }
+             | declarations declaration { $$ = $1; $$->nodes().push_back($2); }
              ;
 
 block_declaration : argument_declaration                { $$ = $1; }
-                  | '(' type tIDENTIFIER expression ')' { $$ = new til::variable_declaration_node(LINE, tPRIVATE, $2, *$3, $4); delete $3; }
+                  | '(' type tIDENTIFIER expression ')' { $$ = ARENA.make<til::variable_declaration_node>(LINE, tPRIVATE, $2, *$3, $4); }
                   /* var */
-                  | '(' tVAR tIDENTIFIER expression ')' { $$ = new til::variable_declaration_node(LINE, tPRIVATE, nullptr, *$3, $4); delete $3; }
+                  | '(' tVAR tIDENTIFIER expression ')' { $$ = ARENA.make<til::variable_declaration_node>(LINE, tPRIVATE, nullptr, *$3, $4); }
                   ;
 
-block_declarations : block_declaration                    { $$ = new cdk::sequence_node(LINE, $1); }
-                   | block_declarations block_declaration { $$ = new cdk::sequence_node(LINE, $2, $1); }
+block_declarations : block_declaration                    { $$ = ARENA.make<arena_sequence_node>(LINE, $1); }
+                   | block_declarations block_declaration { $$ = $1; $$->nodes().push_back($2); }
                    ;
 
-argument_declaration : '(' type tIDENTIFIER ')' { $$ = new til::variable_declaration_node(LINE, tPRIVATE, $2, *$3, nullptr); delete $3; }
+argument_declaration : '(' type tIDENTIFIER ')' { $$ = ARENA.make<til::variable_declaration_node>(LINE, tPRIVATE, $2, *$3, nullptr); }
                      ;
 
-argument_declarations : argument_declaration                       { $$ = new cdk::sequence_node(LINE, $1); }
-                      | argument_declarations argument_declaration { $$ = new cdk::sequence_node(LINE, $2, $1); }
+argument_declarations : argument_declaration                       { $$ = ARENA.make<arena_sequence_node>(LINE, $1); }
+                      | argument_declarations argument_declaration { $$ = $1; $$->nodes().push_back($2); }
                       ;
 
-program : '(' tPROGRAM block ')' { $$ = new til::program_node(LINE, $3); }
+program : '(' tPROGRAM block ')' { $$ = ARENA.make<til::program_node>(LINE, $3); }
         ;
 
-function : '(' tFUNCTION '(' type ')' block ')'                       { $$ = new til::function_definition_node(LINE, cdk::functional_type::create($4), nullptr, $6); }
-         | '(' tFUNCTION '(' type argument_declarations ')' block ')' { $$ = new til::function_definition_node(LINE, cdk::functional_type::create(sequenceToTypes($5), $4), $5, $7); }
+function : '(' tFUNCTION '(' type ')' block ')'                       { $$ = ARENA.make<til::function_definition_node>(LINE, til::types::functional($4), nullptr, $6); }
+         | '(' tFUNCTION '(' type argument_declarations ')' block ')' { $$ = ARENA.make<til::function_definition_node>(LINE, til::types::functional(sequenceToTypes($5), $4), $5, $7); }
          ;
 
 type : data_type     { $$ = $1; }
@@ -124,93 +161,93 @@ types : type       { $$ = new std::vector<std::shared_ptr<cdk::basic_type>>(); $
       | types type { $$ = $1; $$->push_back($2); }
       ;
 
-data_type : tTYPE_INT     { $$ = cdk::primitive_type::create(4, cdk::TYPE_INT); }
-          | tTYPE_DOUBLE  { $$ = cdk::primitive_type::create(8, cdk::TYPE_DOUBLE); }
-          | tTYPE_STRING  { $$ = cdk::primitive_type::create(4, cdk::TYPE_STRING); }
-          | data_type '!' { $$ = cdk::reference_type::create(4, $1); }
+data_type : tTYPE_INT     { $$ = til::types::primitive(4, cdk::TYPE_INT); }
+          | tTYPE_DOUBLE  { $$ = til::types::primitive(8, cdk::TYPE_DOUBLE); }
+          | tTYPE_STRING  { $$ = til::types::primitive(4, cdk::TYPE_STRING); }
+          | data_type '!' { $$ = til::types::reference(4, $1); }
           ;
 
-function_type : '(' type ')'               { $$ = cdk::functional_type::create($2); }
-              | '(' type '(' types ')' ')' { $$ = cdk::functional_type::create(*$4, $2); delete $4; }
-              | function_type '!'          { $$ = cdk::reference_type::create(4, $1); }
+function_type : '(' type ')'               { $$ = til::types::functional($2); }
+              | '(' type '(' types ')' ')' { $$ = til::types::functional(*$4, $2); delete $4; }
+              | function_type '!'          { $$ = til::types::reference(4, $1); }
               ;
 
-void_type : tTYPE_VOID    { $$ = cdk::primitive_type::create(0, cdk::TYPE_VOID); }
-          | void_type '!' { $$ = cdk::reference_type::create(4, cdk::primitive_type::create(0, cdk::TYPE_VOID)); }
+void_type : tTYPE_VOID    { $$ = til::types::primitive(0, cdk::TYPE_VOID); }
+          | void_type '!' { $$ = til::types::reference(4, til::types::primitive(0, cdk::TYPE_VOID)); }
           ;
 
-block : /* empty */                     { $$ = new til::block_node(LINE, nullptr, nullptr); }
-      | block_declarations              { $$ = new til::block_node(LINE, $1, nullptr); }
-      | instructions                    { $$ = new til::block_node(LINE, nullptr, $1); }
-      | block_declarations instructions { $$ = new til::block_node(LINE, $1, $2); }
+block : /* empty */                     { $$ = ARENA.make<til::block_node>(LINE, nullptr, nullptr); }
+      | block_declarations              { $$ = ARENA.make<til::block_node>(LINE, $1, nullptr); }
+      | instructions                    { $$ = ARENA.make<til::block_node>(LINE, nullptr, $1); }
+      | block_declarations instructions { $$ = ARENA.make<til::block_node>(LINE, $1, $2); }
       ;
 
 instruction : '(' tBLOCK block ')'                           { $$ = $3; }
-            | '(' tIF expression instruction ')'             { $$ = new til::if_node(LINE, $3, $4); }
-            | '(' tIF expression instruction instruction ')' { $$ = new til::if_else_node(LINE, $3, $4, $5); }
-            | '(' tLOOP expression instruction ')'           { $$ = new til::loop_node(LINE, $3, $4); }
-            | '(' tSTOP ')'                                  { $$ = new til::stop_node(LINE); }
-            | '(' tSTOP tINTEGER ')'                         { $$ = new til::stop_node(LINE, $3); }
-            | '(' tNEXT ')'                                  { $$ = new til::next_node(LINE); }
-            | '(' tNEXT tINTEGER ')'                         { $$ = new til::next_node(LINE, $3); }
-            | '(' tRETURN ')'                                { $$ = new til::return_node(LINE); }
-            | '(' tRETURN expression ')'                     { $$ = new til::return_node(LINE, $3); }
-            | expression                                     { $$ = new til::evaluation_node(LINE, $1); }
-            | '(' tPRINT expressions ')'                     { $$ = new til::print_node(LINE, $3); }
-            | '(' tPRINTLN expressions ')'                   { $$ = new til::print_node(LINE, $3, true); }
+            | '(' tIF expression instruction ')'             { $$ = ARENA.make<til::if_node>(LINE, $3, $4); }
+            | '(' tIF expression instruction instruction ')' { $$ = ARENA.make<til::if_else_node>(LINE, $3, $4, $5); }
+            | '(' tLOOP expression instruction ')'           { $$ = ARENA.make<til::loop_node>(LINE, $3, $4); }
+            | '(' tSTOP ')'                                  { $$ = ARENA.make<til::stop_node>(LINE); }
+            | '(' tSTOP tINTEGER ')'                         { $$ = ARENA.make<til::stop_node>(LINE, $3); }
+            | '(' tNEXT ')'                                  { $$ = ARENA.make<til::next_node>(LINE); }
+            | '(' tNEXT tINTEGER ')'                         { $$ = ARENA.make<til::next_node>(LINE, $3); }
+            | '(' tRETURN ')'                                { $$ = ARENA.make<til::return_node>(LINE); }
+            | '(' tRETURN expression ')'                     { $$ = ARENA.make<til::return_node>(LINE, $3); }
+            | expression                                     { $$ = ARENA.make<til::evaluation_node>(LINE, $1); }
+            | '(' tPRINT expressions ')'                     { $$ = ARENA.make<til::print_node>(LINE, $3); }
+            | '(' tPRINTLN expressions ')'                   { $$ = ARENA.make<til::print_node>(LINE, $3, true); }
             ;
 
-instructions : instruction              { $$ = new cdk::sequence_node(LINE, $1); }
-             | instructions instruction { $$ = new cdk::sequence_node(LINE, $2, $1); }
+instructions : instruction              { $$ = ARENA.make<arena_sequence_node>(LINE, $1); }
+             | instructions instruction { $$ = $1; $$->nodes().push_back($2); }
              ;
 
-expression : tINTEGER                           { $$ = new cdk::integer_node(LINE, $1); }
-           | tDOUBLE                            { $$ = new cdk::double_node(LINE, $1); }
-           | tSTRING                            { $$ = new cdk::string_node(LINE, $1); delete $1; }
-           | tNULL                              { $$ = new til::nullptr_node(LINE); }
+expression : tINTEGER                           { $$ = ARENA.make<cdk::integer_node>(LINE, $1); }
+           | tDOUBLE                            { $$ = ARENA.make<cdk::double_node>(LINE, $1); }
+           | tSTRING                            { $$ = ARENA.make<cdk::string_node>(LINE, $1); }
+           | tNULL                              { $$ = ARENA.make<til::nullptr_node>(LINE); }
            /* unary expressions */
-           | '(' '-' expression ')'             { $$ = new cdk::unary_minus_node(LINE, $3); }
-           | '(' '+' expression ')'             { $$ = new cdk::unary_plus_node(LINE, $3); }
+           | '(' '-' expression ')'             { $$ = ARENA.make<cdk::unary_minus_node>(LINE, $3); }
+           | '(' '+' expression ')'             { $$ = ARENA.make<cdk::unary_plus_node>(LINE, $3); }
            /* arithmetic expressions */
-           | '(' '+' expression expression ')'  { $$ = new cdk::add_node(LINE, $3, $4); }
-           | '(' '-' expression expression ')'  { $$ = new cdk::sub_node(LINE, $3, $4); }
-           | '(' '*' expression expression ')'  { $$ = new cdk::mul_node(LINE, $3, $4); }
-           | '(' '/' expression expression ')'  { $$ = new cdk::div_node(LINE, $3, $4); }
-           | '(' '%' expression expression ')'  { $$ = new cdk::mod_node(LINE, $3, $4); }
+           | '(' '+' expression expression ')'  { $$ = ARENA.make<cdk::add_node>(LINE, $3, $4); }
+           | '(' '-' expression expression ')'  { $$ = ARENA.make<cdk::sub_node>(LINE, $3, $4); }
+           | '(' '*' expression expression ')'  { $$ = ARENA.make<cdk::mul_node>(LINE, $3, $4); }
+           | '(' '/' expression expression ')'  { $$ = ARENA.make<cdk::div_node>(LINE, $3, $4); }
+           | '(' '%' expression expression ')'  { $$ = ARENA.make<cdk::mod_node>(LINE, $3, $4); }
            /* logical expressions */
-           | '(' '<' expression expression ')'  { $$ = new cdk::lt_node(LINE, $3, $4); }
-           | '(' '>' expression expression ')'  { $$ = new cdk::gt_node(LINE, $3, $4); }
-           | '(' tLE expression expression ')'  { $$ = new cdk::le_node(LINE, $3, $4); }
-           | '(' tGE expression expression ')'  { $$ = new cdk::ge_node(LINE, $3, $4); }
-           | '(' tEQ expression expression ')'  { $$ = new cdk::eq_node(LINE, $3, $4); }
-           | '(' tNE expression expression ')'  { $$ = new cdk::ne_node(LINE, $3, $4); }
-           | '(' '~' expression ')'             { $$ = new cdk::not_node(LINE, $3); }
-           | '(' tAND expression expression ')' { $$ = new cdk::and_node(LINE, $3, $4); }
-           | '(' tOR expression expression ')'  { $$ = new cdk::or_node (LINE, $3, $4); }
+           | '(' '<' expression expression ')'  { $$ = ARENA.make<cdk::lt_node>(LINE, $3, $4); }
+           | '(' '>' expression expression ')'  { $$ = ARENA.make<cdk::gt_node>(LINE, $3, $4); }
+           | '(' tLE expression expression ')'  { $$ = ARENA.make<cdk::le_node>(LINE, $3, $4); }
+           | '(' tGE expression expression ')'  { $$ = ARENA.make<cdk::ge_node>(LINE, $3, $4); }
+           | '(' tEQ expression expression ')'  { $$ = ARENA.make<cdk::eq_node>(LINE, $3, $4); }
+           | '(' tNE expression expression ')'  { $$ = ARENA.make<cdk::ne_node>(LINE, $3, $4); }
+           | '(' '~' expression ')'             { $$ = ARENA.make<cdk::not_node>(LINE, $3); }
+           | '(' tAND expression expression ')' { $$ = ARENA.make<cdk::and_node>(LINE, $3, $4); }
+           | '(' tOR expression expression ')'  { $$ = ARENA.make<cdk::or_node>(LINE, $3, $4); }
            /* assignemnts */
-           | '(' tSET lvalue expression ')'     { $$ = new cdk::assignment_node(LINE, $3, $4); }
+           | '(' tSET lvalue expression ')'     { $$ = ARENA.make<cdk::assignment_node>(LINE, $3, $4); }
            /* identifiers */
-           | lvalue                             { $$ = new cdk::rvalue_node(LINE, $1); }
+           | lvalue                             { $$ = ARENA.make<cdk::rvalue_node>(LINE, $1); }
            /* read */
-           | '(' tREAD ')'                      { $$ = new til::read_node(LINE); }
+           | '(' tREAD ')'                      { $$ = ARENA.make<til::read_node>(LINE); }
            /* functions */
            | function                           { $$ = $1; }
-           | '(' expression ')'                 { $$ = new til::function_call_node(LINE, $2, nullptr); }
-           | '(' expression expressions ')'     { $$ = new til::function_call_node(LINE, $2, $3); }
-           | '(' '@' ')'                        { $$ = new til::function_call_node(LINE, nullptr, nullptr); }
-           | '(' '@' expressions ')'            { $$ = new til::function_call_node(LINE, nullptr, $3); }
+           | '(' expression ')'                 { $$ = ARENA.make<til::function_call_node>(LINE, $2, nullptr); }
+           | '(' expression expressions ')'     { $$ = ARENA.make<til::function_call_node>(LINE, $2, $3); }
+           | '(' '@' ')'                        { $$ = ARENA.make<til::function_call_node>(LINE, nullptr, nullptr); }
+           | '(' '@' expressions ')'            { $$ = ARENA.make<til::function_call_node>(LINE, nullptr, $3); }
            /* others */
-           | '(' tOBJECTS expression ')'        { $$ = new til::stack_alloc_node(LINE, $3); }
-           | '(' '?' lvalue ')'                 { $$ = new til::address_of_node(LINE, $3); }
-           | '(' tSIZEOF expression ')'         { $$ = new til::sizeof_node(LINE, $3); }
+           | '(' tOBJECTS expression ')'        { $$ = ARENA.make<til::stack_alloc_node>(LINE, $3); }
+           | '(' '?' lvalue ')'                 { $$ = ARENA.make<til::address_of_node>(LINE, $3); }
+           | '(' tSIZEOF expression ')'         { $$ = ARENA.make<til::sizeof_node>(LINE, $3); }
            ;
 
-expressions : expression             { $$ = new cdk::sequence_node(LINE, $1); }
-            | expressions expression { $$ = new cdk::sequence_node(LINE, $2, $1); }
+expressions : expression             { $$ = ARENA.make<arena_sequence_node>(LINE, $1); }
+            | expressions expression { $$ = $1; $$->nodes().push_back($2); }
             ;
 
-lvalue : tIDENTIFIER                          { $$ = new cdk::variable_node(LINE, $1); delete $1; }
-       | '(' tINDEX expression expression ')' { $$ = new til::index_node(LINE, $3, $4); }
+lvalue : tIDENTIFIER                          { $$ = ARENA.make<cdk::variable_node>(LINE, $1); }
+       | '(' tINDEX expression expression ')' { $$ = ARENA.make<til::index_node>(LINE, $3, $4); }
        ;
 
 %%